@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "crtc.h"
+
+using namespace crtc;
+
+static const int kWorkers = 4;
+static const int kCalls = 1000000;
+static const int kTasks = 20000;
+static const int kKeys = 16;
+
+static std::atomic<int> count(0);
+static std::atomic<int> failed(0);
+
+static void Spin() {
+  volatile uint32_t hash = 2166136261u;
+
+  for (uint32_t index = 0; index < 20000; index++) {
+    hash = (hash ^ index) * 16777619u;
+  }
+}
+
+static double Run(const std::vector<Let<Worker>> &workers, int producers) {
+  std::vector<std::thread> threads;
+  int calls = kCalls / producers;
+  int total = calls * producers;
+
+  count = 0;
+
+  auto begin = std::chrono::steady_clock::now();
+
+  for (int index = 0; index < producers; index++) {
+    threads.emplace_back([&workers, calls, index]() {
+      Let<Worker> worker = workers[index % workers.size()];
+
+      for (int call = 0; call < calls; call++) {
+        Async::Call([]() {
+          count.fetch_add(1, std::memory_order_relaxed);
+        }, 0, worker);
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  while (count.load() < total) {
+    std::this_thread::yield();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+  return total / elapsed.count();
+}
+
+static double RunPool(int threads) {
+  Let<Worker> pool = Worker::NewPool(threads);
+  std::vector<int> sequence(kKeys, 0);
+
+  count = 0;
+
+  auto begin = std::chrono::steady_clock::now();
+
+  for (int index = 0; index < kTasks; index++) {
+    int key = index % kKeys;
+
+    if (key) {
+      Async::Call([]() {
+        Spin();
+        count.fetch_add(1, std::memory_order_relaxed);
+      }, 0, pool);
+    } else {
+      Async::Call([&sequence, key, index]() {
+        if (sequence[key] != index) {
+          failed++;
+        }
+
+        sequence[key] = index + kKeys;
+        Spin();
+        count++;
+      }, 0, pool->Key(key));
+    }
+  }
+
+  while (count.load() < kTasks) {
+    std::this_thread::yield();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+  return kTasks / elapsed.count();
+}
+
+int main() {
+  Module::Init();
+
+  std::vector<Let<Worker>> workers;
+
+  for (int index = 0; index < kWorkers; index++) {
+    workers.push_back(Worker::New());
+  }
+
+  printf("Async::Call throughput, %d calls into %d workers\n", kCalls, kWorkers);
+
+  for (int producers = 1; producers <= 64; producers *= 2) {
+    printf("%2d producers: %12.0f calls/s\n", producers, Run(workers, producers));
+  }
+
+  workers.clear();
+
+  int cores = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+  printf("Worker::NewPool scaling, %d tasks\n", kTasks);
+
+  for (int threads = 1; threads <= cores; threads++) {
+    printf("%2d threads: %12.0f tasks/s\n", threads, RunPool(threads));
+  }
+
+  if (failed) {
+    printf("Test Failed: %d keyed tasks out of order\n", failed.load());
+  }
+
+  Module::Dispose();
+
+  return 0;
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <chrono>
+
+#include "crtc.h"
+
+using namespace crtc;
+
+static const int kWidth = 1920;
+static const int kHeight = 1080;
+static const int kFrames = 300;
+
+typedef std::chrono::steady_clock Clock;
+
+// Bytes that ended up in memory other than the source, zero when the buffer
+// is a view over it.
+
+static size_t Copied(const Let<ArrayBuffer> &buffer, const uint8_t *source) {
+  return (buffer->Data() == source) ? 0 : buffer->ByteLength();
+}
+
+int main() {
+  Module::Init();
+
+  size_t length = ImageBuffer::ByteLength(kWidth, kHeight);
+  size_t copied = 0, released = 0;
+  int failed = 0;
+
+  // Decoder output handed over as is, released by the deleter.
+
+  Clock::time_point begin = Clock::now();
+
+  for (int index = 0; index < kFrames; index++) {
+    uint8_t *frame = new uint8_t[length];
+
+    Let<ArrayBuffer> buffer = ArrayBuffer::Adopt(frame, length, [&](uint8_t *data, size_t byteLength) {
+      released += byteLength;
+      delete [] data;
+    });
+
+    Let<ImageBuffer> image = ImageBuffer::New(buffer, kWidth, kHeight);
+
+    if (image.IsEmpty() || image->DataY() != frame) {
+      failed++;
+      continue;
+    }
+
+    copied += Copied(image, frame);
+  }
+
+  double adopted = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  printf("adopt: %.1f bytes copied per frame, %zu of %zu bytes released, %.3f ms per frame\n",
+         static_cast<double>(copied) / kFrames, released, length * kFrames, adopted / kFrames);
+
+  // Same frames through the copying constructor for comparison.
+
+  std::string source(length, 0);
+  size_t duplicated = 0;
+
+  begin = Clock::now();
+
+  for (int index = 0; index < kFrames; index++) {
+    Let<ArrayBuffer> buffer = ArrayBuffer::New(source);
+    Let<ImageBuffer> image = ImageBuffer::New(buffer, kWidth, kHeight);
+
+    duplicated += Copied(image, reinterpret_cast<const uint8_t*>(source.data()));
+  }
+
+  double copying = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  printf("copy: %.1f bytes copied per frame, %.3f ms per frame\n",
+         static_cast<double>(duplicated) / kFrames, copying / kFrames);
+
+  // Audio borrowed from a larger buffer, which stays alive with the frame.
+
+  Let<ArrayBuffer> pcm = ArrayBuffer::New(480 * 2 * 2 * 10);
+  Let<AudioBuffer> audio = AudioBuffer::New(ArrayBuffer::Borrow(pcm->Data(), 480 * 2 * 2, pcm), 2, 48000, 16, 480);
+  size_t samples = (audio->Data() == pcm->Data()) ? 0 : audio->ByteLength();
+
+  printf("audio: %zu bytes copied per frame\n", samples);
+
+  // Frames of a 720p source, recycled by the pool and allocated fresh.
+
+  size_t frame = ImageBuffer::ByteLength(1280, 720);
+  uint64_t checksum = 0;
+
+  begin = Clock::now();
+
+  for (int index = 0; index < kFrames; index++) {
+    Let<ArrayBuffer> buffer = ArrayBuffer::New(frame);
+    checksum += buffer->Data()[index];
+  }
+
+  double fresh = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  begin = Clock::now();
+
+  for (int index = 0; index < kFrames; index++) {
+    Let<ImageBuffer> image = ImageBuffer::New(1280, 720);
+    checksum += image->Data()[index];
+  }
+
+  double pooled = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  begin = Clock::now();
+
+  for (int index = 0; index < kFrames; index++) {
+    Let<ImageBuffer> image = ImageBuffer::New(1280, 720, false);
+    image->Data()[index] = 0;
+  }
+
+  double unfilled = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  printf("720p: new %.3f ms, pooled %.3f ms, pooled without zero fill %.3f ms per frame\n",
+         fresh / kFrames, pooled / kFrames, unfilled / kFrames);
+
+  for (const auto &stats : BufferPool::Stats()) {
+    printf("pool %zu bytes: %llu allocs, %llu hits, %llu misses, %zu bytes resident\n", stats.size,
+           static_cast<unsigned long long>(stats.allocs), static_cast<unsigned long long>(stats.hits),
+           static_cast<unsigned long long>(stats.misses), stats.resident);
+  }
+
+  if (failed || copied || released != length * kFrames || samples || checksum) {
+    printf("Test Failed!\n");
+  }
+
+  Module::Dispose();
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <vector>
+
+#include "crtc.h"
+
+using namespace crtc;
+
+static const int kConnections = 10000;
+static const int kBatch = 100;
+
+// Creates and drops peer connections with handlers on them and on a data
+// channel, all capturing WeakLet's, and reports how many are still alive
+// once their events have been dispatched. Anything but zero is a leak.
+//
+// The library itself holds no Let on its owners: peer connections, data
+// channels, streams, tracks and sinks register themselves to webrtc as raw
+// observers and unregister in their destructors, pending ICE candidates are
+// owned by the connection, promise executors hold the connection only until
+// they settle, and timers, pool lanes, clock entries and abortable calls
+// already point back through WeakLet's.
+
+int main() {
+  Module::Init();
+
+  std::vector<WeakLet<RTCPeerConnection>> connections;
+  std::vector<WeakLet<RTCDataChannel>> channels;
+  size_t offers = 0, candidates = 0, errors = 0;
+
+  connections.reserve(kConnections);
+  channels.reserve(kConnections);
+
+  for (int index = 0; index < kConnections; index++) {
+    Let<RTCPeerConnection> pc = RTCPeerConnection::New();
+    WeakLet<RTCPeerConnection> weak(pc);
+
+    pc->onicecandidate = [weak, &candidates](const RTCPeerConnection::RTCIceCandidate &candidate) {
+      if (!weak.Lock().IsEmpty()) {
+        candidates++;
+      }
+    };
+
+    pc->onsignalingstatechange = [weak]() {
+      Let<RTCPeerConnection> pc = weak.Lock();
+
+      if (!pc.IsEmpty() && pc->SignalingState() == RTCPeerConnection::kSignalingClosed) {
+        pc->onicecandidate.Dispose();
+      }
+    };
+
+    Let<RTCDataChannel> dc = pc->CreateDataChannel("churn");
+
+    if (!dc.IsEmpty()) {
+      WeakLet<RTCDataChannel> channel(dc);
+
+      dc->onclose = [channel]() {
+        Let<RTCDataChannel> dc = channel.Lock();
+
+        if (!dc.IsEmpty()) {
+          dc->onmessage.Dispose();
+        }
+      };
+
+      dc->onmessage = [channel](const Let<ArrayBuffer> &buffer, bool binary) {
+        Let<RTCDataChannel> dc = channel.Lock();
+
+        if (!dc.IsEmpty()) {
+          dc->Send(buffer, binary);
+        }
+      };
+
+      channels.push_back(channel);
+    }
+
+    pc->CreateOffer()->Then([weak, &offers](const RTCPeerConnection::RTCSessionDescription &offer) {
+      Let<RTCPeerConnection> pc = weak.Lock();
+
+      if (!pc.IsEmpty()) {
+        offers++;
+        pc->Close();
+      }
+    })->Catch([&errors](const Let<Error> &error) {
+      errors++;
+    });
+
+    connections.push_back(weak);
+
+    if (!((index + 1) % kBatch)) {
+      Module::DispatchEvents(false);
+    }
+  }
+
+  Module::DispatchEvents(true);
+
+  size_t alive = 0, open = 0;
+
+  for (const WeakLet<RTCPeerConnection> &weak : connections) {
+    alive += (!weak.Lock().IsEmpty()) ? 1 : 0;
+  }
+
+  for (const WeakLet<RTCDataChannel> &weak : channels) {
+    open += (!weak.Lock().IsEmpty()) ? 1 : 0;
+  }
+
+  printf("connections: %zu of %d alive, data channels: %zu of %zu alive\n", alive, kConnections, open, channels.size());
+  printf("offers: %zu, candidates: %zu, errors: %zu\n", offers, candidates, errors);
+
+  Module::Dispose();
+  return (alive || open) ? 1 : 0;
+}
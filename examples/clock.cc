@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "crtc.h"
+
+using namespace crtc;
+
+static const int kSources = 1000;
+static const int kInterval = 33;
+static const int kDuration = 3000;
+
+typedef std::chrono::steady_clock Clock;
+
+class Source {
+  public:
+    int ticks = 0;
+    double late = 0;
+    double total = 0;
+    Clock::time_point start;
+    std::thread::id thread;
+    Let<RealTimeClock> clock;
+};
+
+int main() {
+  Module::Init();
+
+  std::vector<Source> sources(kSources);
+
+  for (Source &source : sources) {
+    Source *ptr = &source;
+
+    source.clock = RealTimeClock::New([ptr]() {
+      Clock::time_point now = Clock::now();
+
+      if (!ptr->ticks) {
+        ptr->start = now;
+      }
+
+      // Lateness against the ideal schedule of the source, not the previous tick.
+
+      Clock::time_point deadline = ptr->start + std::chrono::milliseconds(kInterval * ptr->ticks);
+      double late = std::chrono::duration<double, std::milli>(now - deadline).count();
+
+      ptr->late = (late > ptr->late) ? late : ptr->late;
+      ptr->total += late;
+      ptr->thread = std::this_thread::get_id();
+      ptr->ticks++;
+    });
+
+    source.clock->Start(kInterval);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(kDuration));
+
+  for (Source &source : sources) {
+    source.clock->Stop();
+  }
+
+  std::set<std::thread::id> threads;
+  int expected = kDuration / kInterval + 1, least = expected * 2, most = 0;
+  double late = 0, total = 0;
+
+  for (Source &source : sources) {
+    threads.insert(source.thread);
+    least = (source.ticks < least) ? source.ticks : least;
+    most = (source.ticks > most) ? source.ticks : most;
+    late = (source.late > late) ? source.late : late;
+    total += source.total / source.ticks;
+  }
+
+  printf("%d sources at %d ms on %d threads\n", kSources, kInterval, static_cast<int>(threads.size()));
+  printf("ticks per source: %d - %d (expected about %d)\n", least, most, expected);
+  printf("lateness: average %.3f ms, max %.3f ms\n", total / kSources, late);
+
+  RealTimeClock::ClockStats stats = {};
+
+  for (Source &source : sources) {
+    RealTimeClock::ClockStats clock = source.clock->Stats();
+
+    stats.ticks += clock.ticks;
+    stats.missed += clock.missed;
+    stats.overruns += clock.overruns;
+
+    for (int index = 0; index < RealTimeClock::kBuckets; index++) {
+      stats.jitter[index] += clock.jitter[index];
+    }
+  }
+
+  printf("missed %llu, overruns %llu, jitter:\n",
+         static_cast<unsigned long long>(stats.missed),
+         static_cast<unsigned long long>(stats.overruns));
+
+  for (int index = 0; index < RealTimeClock::kBuckets; index++) {
+    if (stats.jitter[index]) {
+      printf("  < %7d us: %llu\n", 1 << index, static_cast<unsigned long long>(stats.jitter[index]));
+    }
+  }
+
+  if (least < expected - 2 || most > expected + 2) {
+    printf("Test Failed!\n");
+  }
+
+  sources.clear();
+  Module::Dispose();
+
+  return 0;
+};
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <poll.h>
+#include <chrono>
+
+#include "crtc.h"
+
+using namespace crtc;
+
+static const int kTimeouts = 50;
+static const int kDelay = 10;
+static const size_t kBatch = 16;
+
+typedef std::chrono::steady_clock Clock;
+
+static int fired = 0;
+static double late = 0;
+
+static void Schedule() {
+  Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(kDelay);
+
+  SetTimeout([=]() {
+    late += std::chrono::duration<double, std::milli>(Clock::now() - deadline).count();
+
+    if (++fired < kTimeouts) {
+      Schedule();
+    }
+  }, kDelay);
+}
+
+int main() {
+  Module::Init();
+
+  int fd = Module::EventFd();
+
+  if (fd < 0) {
+    printf("Module::EventFd() is not supported on this platform\n");
+    Module::Dispose();
+    return 0;
+  }
+
+  Schedule();
+
+  // Host loop waits only on its own descriptors, crtc work is dispatched in
+  // small batches when its descriptor becomes readable.
+
+  struct pollfd fds = { fd, POLLIN, 0 };
+  int wakeups = 0;
+  size_t tasks = 0;
+
+  while (fired < kTimeouts) {
+    if (poll(&fds, 1, 1000) <= 0) {
+      printf("Test Failed! No events in a second.\n");
+      break;
+    }
+
+    wakeups++;
+    tasks += Module::DispatchEvents(5, kBatch);
+  }
+
+  printf("%d timeouts in %d wakeups, %d tasks\n", fired, wakeups, static_cast<int>(tasks));
+  printf("lateness: average %.3f ms\n", late / fired);
+
+  Module::Dispose();
+  return 0;
+}
\ No newline at end of file
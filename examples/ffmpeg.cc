@@ -6,20 +6,24 @@
 
 using namespace crtc;
 
-const size_t byteLength = 1382400;
+const size_t byteLength = ImageBuffer::ByteLength(1280, 720, ImageBuffer::kNV12);
 
-// ffmpeg -f avfoundation -pix_fmt nv12 -s 1280x720 -i "0x7ffb5e40e8a0" -c:v rawvideo -f rawvideo -pix_fmt yuv420p -s 1280x720 - | ./out/ffmpeg | ffmpeg -f rawvideo -pix_fmt yuv420p -s:v 1280x720 -i pipe:0 -c:v libx264 -y output.mp4
+// ffmpeg -f avfoundation -pix_fmt nv12 -s 1280x720 -i "0x7ffb5e40e8a0" -c:v rawvideo -f rawvideo -pix_fmt nv12 -s 1280x720 - | ./out/ffmpeg | ffmpeg -f rawvideo -pix_fmt yuv420p -s:v 1280x720 -i pipe:0 -c:v libx264 -y output.mp4
 
-void ReadFrame(const Let<VideoSource> &source, const Let<ArrayBuffer> &buffer) {
+void ReadFrame(const Let<VideoSource> &source) {
   if (source->IsRunning()) {
+    // Frames share memory with their buffer, each one gets its own from the
+    // pool and gives it back once WebRTC is done with it.
+
+    Let<ArrayBuffer> buffer = BufferPool::New(byteLength, false);
     size_t bytes = fread(buffer->Data(), 1, buffer->ByteLength(), stdin);
 
     if (bytes == buffer->ByteLength()) {
-      source->Write(ImageBuffer::New(buffer, 1280, 720), [=](const Let<Error> &error) {
+      source->Write(ImageBuffer::New(buffer, 1280, 720, ImageBuffer::kNV12), [=](const Let<Error> &error) {
         if (!error.IsEmpty()) {
           fprintf(stderr, "VideoSource::Write(%s)\n", error->ToString().c_str());
         } else {
-          SetTimeout(&ReadFrame, 33, source, buffer);
+          SetTimeout(&ReadFrame, 33, source);
         }
       });
     } else {
@@ -55,8 +59,7 @@ int main() {
   }
   
   Worker::New([=]() {
-    Let<ArrayBuffer> buffer = ArrayBuffer::New(byteLength);
-    ReadFrame(source, buffer);
+    ReadFrame(source);
   });
 
   Module::DispatchEvents(true);
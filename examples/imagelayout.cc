@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "crtc.h"
+#include "libyuv/convert.h"
+#include "libyuv/convert_from.h"
+#include "libyuv/scale.h"
+
+using namespace crtc;
+
+static const int kWidth = 1366;
+static const int kHeight = 768;
+static const int kScaledWidth = 960;
+static const int kScaledHeight = 540;
+static const int kAlignment = 64;
+static const int kRounds = 200;
+
+typedef std::chrono::steady_clock Clock;
+
+static uint8_t *Plane(const uint8_t *data) {
+  return const_cast<uint8_t*>(data);
+}
+
+// Scales like I420Buffer::ScaleFrom() and converts to and from BGRA the
+// way capturers and renderers do, between images of the same layout.
+
+static void Run(const char *name, const Let<ImageBuffer> &source, const Let<ImageBuffer> &scaled, const Let<ImageBuffer> &converted) {
+  std::vector<uint8_t> argb(kWidth * kHeight * 4);
+
+  Clock::time_point begin = Clock::now();
+
+  for (int index = 0; index < kRounds; index++) {
+    libyuv::I420Scale(source->DataY(), source->StrideY(), source->DataU(), source->StrideU(), source->DataV(), source->StrideV(), kWidth, kHeight,
+                      Plane(scaled->DataY()), scaled->StrideY(), Plane(scaled->DataU()), scaled->StrideU(), Plane(scaled->DataV()), scaled->StrideV(),
+                      kScaledWidth, kScaledHeight, libyuv::kFilterBox);
+  }
+
+  double scale = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  begin = Clock::now();
+
+  for (int index = 0; index < kRounds; index++) {
+    libyuv::I420ToARGB(source->DataY(), source->StrideY(), source->DataU(), source->StrideU(), source->DataV(), source->StrideV(),
+                       argb.data(), kWidth * 4, kWidth, kHeight);
+  }
+
+  double toArgb = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  begin = Clock::now();
+
+  for (int index = 0; index < kRounds; index++) {
+    libyuv::ARGBToI420(argb.data(), kWidth * 4, Plane(converted->DataY()), converted->StrideY(), Plane(converted->DataU()), converted->StrideU(),
+                       Plane(converted->DataV()), converted->StrideV(), kWidth, kHeight);
+  }
+
+  double fromArgb = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  printf("%s: stride %d/%d, scale %.3f ms, I420 to ARGB %.3f ms, ARGB to I420 %.3f ms\n", name, source->StrideY(), source->StrideU(),
+         scale / kRounds, toArgb / kRounds, fromArgb / kRounds);
+}
+
+int main() {
+  Module::Init();
+
+  Run("packed", ImageBuffer::New(kWidth, kHeight), ImageBuffer::New(kScaledWidth, kScaledHeight), ImageBuffer::New(kWidth, kHeight));
+
+  Run("aligned", ImageBuffer::NewAligned(kWidth, kHeight, kAlignment), ImageBuffer::NewAligned(kScaledWidth, kScaledHeight, kAlignment),
+      ImageBuffer::NewAligned(kWidth, kHeight, kAlignment));
+
+  Module::Dispose();
+  return 0;
+}
\ No newline at end of file
@@ -21,28 +21,23 @@ int recv_pong = 0;
 int messages_in = 0;
 int messages_out = 0;
 
-void RemovePeerEvents(const Let<RTCPeerConnection> &peer) {
-  peer->onsignalingstatechange.Dispose();
-  peer->onicegatheringstatechange.Dispose();
-  peer->oniceconnectionstatechange.Dispose();
-  peer->onicecandidatesremoved.Dispose();
-  peer->onaddstream.Dispose();
-  peer->onremovestream.Dispose();
-  peer->ondatachannel.Dispose();
-  peer->onicecandidate.Dispose();
-}
-
-void RemoveChannelEvents(const Let<RTCDataChannel> &dc) {
-  dc->onopen.Dispose();
-  dc->onclose.Dispose();
-  dc->onerror.Dispose();
-  dc->onmessage.Dispose();
-}
+// Handlers capture WeakLet's of the peers, a Let<RTCPeerConnection> stored in
+// its own handler would keep the connection alive forever.
 
 void makePair(const std::string &left, const std::string &right,
-              const Let<RTCPeerConnection> &ls, const Let<RTCPeerConnection> &rs) 
+              const Let<RTCPeerConnection> &local, const Let<RTCPeerConnection> &remote) 
 {
-  ls->onnegotiationneeded = [=]() {
+  WeakLet<RTCPeerConnection> weak_ls(local);
+  WeakLet<RTCPeerConnection> weak_rs(remote);
+
+  local->onnegotiationneeded = [=]() {
+    Let<RTCPeerConnection> ls = weak_ls.Lock();
+    Let<RTCPeerConnection> rs = weak_rs.Lock();
+
+    if (ls.IsEmpty() || rs.IsEmpty()) {
+      return;
+    }
+
     std::cout << left << " <-> " << right << " [OnNegotiationNeeded]" << std::endl;
 
     ls->CreateOffer()->Then([=](const RTCPeerConnection::RTCSessionDescription &offer) {
@@ -72,7 +67,13 @@ void makePair(const std::string &left, const std::string &right,
     });
   };
 
-  ls->onsignalingstatechange = [=]() {
+  local->onsignalingstatechange = [=]() {
+    Let<RTCPeerConnection> ls = weak_ls.Lock();
+
+    if (ls.IsEmpty()) {
+      return;
+    }
+
     switch (ls->SignalingState()) {
       case RTCPeerConnection::kStable:
         std::cout << left << " <-> " << right << " [OnSignalingStateChange]: stable" << std::endl;
@@ -91,17 +92,18 @@ void makePair(const std::string &left, const std::string &right,
         break;
       case RTCPeerConnection::kSignalingClosed:
         closed_peers++;
-
-        SetImmediate([=]() {
-          RemovePeerEvents(ls);
-        });
-
         std::cout << left << " <-> " << right << " [OnSignalingStateChange]: closed" << std::endl;
         break;
     }
   };
 
-  ls->onicegatheringstatechange = [=]() {
+  local->onicegatheringstatechange = [=]() {
+    Let<RTCPeerConnection> ls = weak_ls.Lock();
+
+    if (ls.IsEmpty()) {
+      return;
+    }
+
     switch (ls->IceGatheringState()) {
       case RTCPeerConnection::kNewGathering:
         std::cout << left << " <-> " << right << " [OnIceGatheringStateChange]: new" << std::endl;
@@ -115,7 +117,13 @@ void makePair(const std::string &left, const std::string &right,
     }
   };
 
-  ls->oniceconnectionstatechange = [=]() {
+  local->oniceconnectionstatechange = [=]() {
+    Let<RTCPeerConnection> ls = weak_ls.Lock();
+
+    if (ls.IsEmpty()) {
+      return;
+    }
+
     switch (ls->IceConnectionState()) {
       case RTCPeerConnection::kNew:
         std::cout << left << " <-> " << right << " [OnIceConnectionStateChange]: new" << std::endl;
@@ -141,20 +149,28 @@ void makePair(const std::string &left, const std::string &right,
     }
   };
 
-  ls->onicecandidatesremoved = [=]() {
+  local->onicecandidatesremoved = [=]() {
     std::cout << left << " <-> " << right << " [OnIceCandidatesRemoved]" << std::endl;
   };
 
-  ls->onaddstream = [=](const Let<MediaStream> &stream) {
+  local->onaddstream = [=](const Let<MediaStream> &stream) {
     std::cout << left << " <-> " << right << " [OnAddStream]" << std::endl;
   };
 
-  ls->onremovestream = [=](const Let<MediaStream> &stream) {
+  local->onremovestream = [=](const Let<MediaStream> &stream) {
     std::cout << left << " <-> " << right << " [OnRemoveStream]" << std::endl;
   };
 
-  ls->ondatachannel = [=](const Let<RTCDataChannel> &dataChannel) {
+  local->ondatachannel = [=](const Let<RTCDataChannel> &dataChannel) {
+    WeakLet<RTCDataChannel> weak_dc(dataChannel);
+
     dataChannel->onopen = [=]() {
+      Let<RTCDataChannel> dataChannel = weak_dc.Lock();
+
+      if (dataChannel.IsEmpty()) {
+        return;
+      }
+
       open_channels++;
       std::cout << left << " ==> " << right << " [DataChannel: " << dataChannel->Id() << ", Label: " << dataChannel->Label() << "]: Opened" << std::endl;
 
@@ -166,19 +182,33 @@ void makePair(const std::string &left, const std::string &right,
     };
 
     dataChannel->onclose = [=]() {
-      SetImmediate([=]() {
-        RemoveChannelEvents(dataChannel);
-      });
+      Let<RTCDataChannel> dataChannel = weak_dc.Lock();
+
+      if (dataChannel.IsEmpty()) {
+        return;
+      }
 
       closed_channels++;
       std::cout << left << " ==> " << right << " [DataChannel: " << dataChannel->Id() << ", Label: " << dataChannel->Label() << "]: Closed" << std::endl;
     };
 
     dataChannel->onerror = [=](const Let<Error> &error) {
+      Let<RTCDataChannel> dataChannel = weak_dc.Lock();
+
+      if (dataChannel.IsEmpty()) {
+        return;
+      }
+
       std::cout << left << " ==> " << right << " [DataChannel: " << dataChannel->Id() << ", Label: " << dataChannel->Label() << "]: " << error->ToString() << std::endl;
     };
 
     dataChannel->onmessage = [=](const Let<ArrayBuffer> &buffer, bool binary) {
+      Let<RTCDataChannel> dataChannel = weak_dc.Lock();
+
+      if (dataChannel.IsEmpty()) {
+        return;
+      }
+
       std::cout << left << " ==> " << right << " [DataChannel: " << dataChannel->Id() << ", Label: " << dataChannel->Label() << "]: Message" << std::endl;
       messages_in++;
 
@@ -214,7 +244,13 @@ void makePair(const std::string &left, const std::string &right,
     channels.push_back(dataChannel);
   };
 
-  ls->onicecandidate = [=](const RTCPeerConnection::RTCIceCandidate &iceCandidate) {
+  local->onicecandidate = [=](const RTCPeerConnection::RTCIceCandidate &iceCandidate) {
+    Let<RTCPeerConnection> rs = weak_rs.Lock();
+
+    if (rs.IsEmpty()) {
+      return;
+    }
+
     std::cout << left << " <-> " << right << " [OnIceCandidate]" << std::endl;
 
     rs->AddIceCandidate(iceCandidate)->Then([=]() {
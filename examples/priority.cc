@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "crtc.h"
+
+using namespace crtc;
+
+static const int kBulk = 200000;
+static const int kMedia = 200;
+static const int kDeadlines = 100;
+
+typedef std::chrono::steady_clock Clock;
+
+static void Spin(int us) {
+  Clock::time_point end = Clock::now() + std::chrono::microseconds(us);
+
+  while (Clock::now() < end) { }
+}
+
+// Floods a worker with bulk tasks and posts a media task every millisecond
+// on top of them, media lateness shows whether lanes keep them apart.
+
+static void Run(const char *name, Worker::Priority media) {
+  Worker::WorkerOptions options;
+
+  // Bulk work should not steal the cpu from the rest of the process.
+
+  options.name = "priority";
+  options.policy = Worker::kPolicyBatch;
+
+  Let<Worker> worker = Worker::New(options);
+  std::atomic<int> bulk(0), ran(0);
+  double late = 0, latest = 0;
+
+  for (int index = 0; index < kBulk; index++) {
+    Async::Call([&]() {
+      Spin(2);
+      bulk++;
+    }, Worker::kBackground, 0, worker);
+  }
+
+  for (int index = 0; index < kDeadlines; index++) {
+    Async::Call([]() { }, Worker::kBackground, 1, worker);
+  }
+
+  for (int index = 0; index < kMedia; index++) {
+    Clock::time_point queued = Clock::now();
+
+    Async::Call([&, queued]() {
+      double ms = std::chrono::duration<double, std::milli>(Clock::now() - queued).count();
+
+      late += ms;
+      latest = (ms > latest) ? ms : latest;
+      ran++;
+    }, media, 0, worker);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  while (ran.load() < kMedia || bulk.load() < kBulk) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  Worker::WorkerStats stats = worker->Stats();
+  uint64_t p99 = Worker::Percentile(stats.lanes[media].delay, 99);
+
+  printf("%s: media lateness average %.3f ms, max %.3f ms, p99 < %llu us\n", name, late / kMedia, latest,
+         static_cast<unsigned long long>(p99));
+  printf("%s: %llu background tasks ran, %llu expired after their deadline\n", name,
+         static_cast<unsigned long long>(stats.lanes[Worker::kBackground].tasks),
+         static_cast<unsigned long long>(stats.lanes[Worker::kBackground].expired));
+  printf("%s: busy %.1f%%, task run time p50 < %llu us, p99 < %llu us, %llu still queued\n", name,
+         (stats.uptime) ? 100.0 * stats.busy / stats.uptime : 0.0,
+         static_cast<unsigned long long>(Worker::Percentile(stats.runtime, 50)),
+         static_cast<unsigned long long>(Worker::Percentile(stats.runtime, 99)),
+         static_cast<unsigned long long>(stats.depth));
+}
+
+int main() {
+  Module::Init();
+
+  Run("same lane", Worker::kBackground);
+  Run("realtime lane", Worker::kRealtime);
+
+  Module::Dispose();
+  return 0;
+};
\ No newline at end of file
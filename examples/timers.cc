@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+#include "crtc.h"
+
+using namespace crtc;
+
+static const int kTimers = 100000;
+static const int kSpread = 5000;
+
+typedef std::chrono::steady_clock Clock;
+
+static int fired = 0, cleared = 0, ticks = 0;
+static double late = 0, latest = 0;
+
+static double Elapsed(Clock::time_point begin) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+}
+
+int main() {
+  Module::Init();
+
+  Let<Worker> worker = Worker::New([]() {
+    std::vector<Let<Timer>> timers;
+    timers.reserve(kTimers);
+
+    Clock::time_point begin = Clock::now();
+
+    for (int index = 0; index < kTimers; index++) {
+      int delay = 1 + static_cast<int>((index * 2654435761u) % kSpread);
+      Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(delay);
+
+      timers.push_back(SetTimeout([=]() {
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - deadline).count();
+
+        late += ms;
+        latest = (ms > latest) ? ms : latest;
+        fired++;
+      }, delay));
+    }
+
+    printf("SetTimeout: %.1f ns per timer\n", Elapsed(begin) / kTimers);
+
+    begin = Clock::now();
+
+    for (int index = 0; index < kTimers; index += 2) {
+      ClearTimeout(timers[index]);
+      cleared++;
+    }
+
+    printf("ClearTimeout: %.1f ns per timer\n", Elapsed(begin) / cleared);
+
+    Let<Timer> interval = SetInterval([]() {
+      ticks++;
+    }, 10);
+
+    SetTimeout([=]() {
+      ClearInterval(interval);
+    }, 1005);
+  });
+
+  Module::DispatchEvents(true);
+
+  printf("%d timers fired, %d cleared, %d interval ticks (expected 100)\n", fired, cleared, ticks);
+  printf("lateness: average %.3f ms, max %.3f ms\n", fired ? late / fired : 0, latest);
+
+  if (fired + cleared != kTimers || ticks != 100) {
+    printf("Test Failed!\n");
+  }
+
+  worker.Dispose();
+  Module::Dispose();
+
+  return 0;
+};
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "crtc.h"
+
+using namespace crtc;
+
+static const int kMessages = 100000;
+static const int kSize = 64;
+
+typedef std::chrono::steady_clock Clock;
+
+int main() {
+  Module::Init();
+
+  int fds[2];
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    printf("Test Failed! socketpair()\n");
+    return 1;
+  }
+
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+  std::atomic<long> received(0);
+  std::atomic<int> ticks(0), wakeups(0);
+  std::atomic<bool> done(false);
+
+  Let<Worker> worker = Worker::New();
+
+  // Reader and a timer share the worker thread, neither hops to another one.
+
+  Let<Timer> timer = Timer::New([&]() {
+    ticks++;
+  }, 10, 10, worker);
+
+  bool watching = worker->Watch(fds[1], Worker::kReadable, [&](int fd, int events) {
+    char buffer[4096];
+    ssize_t size;
+
+    wakeups++;
+
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+      received += size;
+    }
+
+    if (received.load() >= static_cast<long>(kMessages) * kSize || (events & Worker::kError)) {
+      Worker::This()->Unwatch(fd);
+      done = true;
+    }
+  });
+
+  if (!watching) {
+    printf("Worker::Watch() is not supported on this platform\n");
+    close(fds[0]);
+    close(fds[1]);
+    Module::Dispose();
+    return 0;
+  }
+
+  Clock::time_point begin = Clock::now();
+  char message[kSize] = { 0 };
+
+  for (int index = 0; index < kMessages; index++) {
+    if (write(fds[0], message, sizeof(message)) != sizeof(message)) {
+      printf("Test Failed! write()\n");
+      break;
+    }
+  }
+
+  while (!done.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+  timer->Clear();
+
+  printf("%ld bytes in %.1f ms, %d wakeups, %d timer ticks on the same thread\n",
+         received.load(), ms, wakeups.load(), ticks.load());
+
+  if (received.load() != static_cast<long>(kMessages) * kSize) {
+    printf("Test Failed!\n");
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+
+  worker.Dispose();
+  Module::Dispose();
+
+  return 0;
+};
\ No newline at end of file
@@ -43,11 +43,26 @@ WebRTC uses Real-Time Protocol to transfer audio and video.
 #ifndef INCLUDE_CRTC_H_
 #define INCLUDE_CRTC_H_
 
+#include <new>
+#include <atomic>
 #include <utility>
+#include <type_traits>
 #include <memory>
 #include <vector>
+#include <tuple>
 #include <string>
 
+#if defined(__cpp_impl_coroutine) && defined(__has_include) && __cplusplus > 201703L
+  #if __has_include(<coroutine>)
+    #include <coroutine>
+    #include <exception>
+
+    #ifdef __cpp_lib_coroutine
+      #define CRTC_HAS_COROUTINES 1
+    #endif
+  #endif
+#endif
+
 #ifdef CRTC_OS_WIN
   #define CRTC_EXPORT __declspec(dllexport)
   #define CRTC_NO_EXPORT __declspec(dllimport)
@@ -88,6 +103,33 @@ class CRTC_EXPORT Time {
     static double Since(int64_t begin, int64_t end = Now()); // returns seconds
 };
 
+/// Memory behind every Let<T>::New. By default small objects come from per thread
+/// caches of fixed size blocks, larger ones from the system allocator.
+/// Custom callbacks must be installed before anything is allocated.
+
+class CRTC_EXPORT Allocator {
+    CRTC_STATIC(Allocator);
+
+  public:
+    typedef void* (*AllocCallback)(size_t size);
+    typedef void (*FreeCallback)(void *ptr, size_t size);
+
+    typedef struct {
+      size_t size;       // block size of the class in bytes
+      uint64_t allocs;   // total allocations
+      uint64_t frees;    // total releases
+      uint64_t hits;     // allocations served from the thread cache
+      uint64_t misses;   // allocations that refilled from the shared pool or a new slab
+      size_t resident;   // bytes of slab memory held by the class
+    } PoolStats;
+
+    static void *Alloc(size_t size);
+    static void Free(void *ptr, size_t size);
+
+    static void SetCallbacks(AllocCallback alloc = nullptr, FreeCallback free = nullptr);
+    static std::vector<PoolStats> Stats();
+};
+
 /// \sa https://developer.mozilla.org/en/docs/Web/JavaScript/Reference/Statements/let
 
 template <class T> class Let {
@@ -114,8 +156,12 @@ template <class T> class Let {
       Let::AddRef();
     }
 
-    template <class S> inline Let(Let<S> src) : _ptr(reinterpret_cast<T*>(*src)) {
-      Let::AddRef();
+    inline Let(Let<T> &&src) noexcept : _ptr(src._ptr) {
+      src._ptr = nullptr;
+    }
+
+    template <class S> inline Let(Let<S> src) : _ptr(reinterpret_cast<T*>(src._ptr)) {
+      src._ptr = nullptr;
     }
 
     inline Let<T> &operator=(T* src) {
@@ -136,6 +182,20 @@ template <class T> class Let {
     }
 
     inline Let<T> &operator=(const Let<T> &src) { return *this = src._ptr; }
+
+    inline Let<T> &operator=(Let<T> &&src) noexcept {
+      if (this != &src) {
+        T* ptr = _ptr;
+
+        _ptr = src._ptr;
+        src._ptr = nullptr;
+
+        if (ptr) { ptr->RemoveRef(); }
+      }
+
+      return *this;
+    }
+
     inline bool IsEmpty() const { return (_ptr == nullptr); }
     inline operator T* () const { return _ptr; }
     inline T* operator*() const { return _ptr; }
@@ -159,33 +219,24 @@ template <class T> class Let {
     }
 
   private:
+    template <class S> friend class Let;
+    template <class S> friend class LocalLet;
+    template <class S> friend class WeakLet;
+
     template <typename... Args> class Constructor : public T {
       public:
-        explicit Constructor(Args&&... args) : T(std::forward<Args>(args)...), reference_count(0) { }
-
-      protected:
-        inline virtual int AddRef() const {
-          return Atomic::Increment(&reference_count);
-        }
-
-        inline virtual int RemoveRef() const {
-          int res = Atomic::Decrement(&reference_count);
+        explicit Constructor(Args&&... args) : T(std::forward<Args>(args)...) { }
 
-          if (!res) {
-            delete this;
-          }
-
-          return res;
+        inline static void *operator new(size_t size) {
+          return Allocator::Alloc(size);
         }
 
-        inline virtual int RefCount() const {
-          return Atomic::AcquireLoad(&reference_count);
+        inline static void operator delete(void *ptr, size_t size) {
+          Allocator::Free(ptr, size);
         }
 
+      protected:
         virtual ~Constructor() { }
-
-      private:
-        mutable volatile int reference_count = 0;
     };
 
     inline void AddRef() const {
@@ -202,13 +253,269 @@ template <class T> class Let {
 
 class CRTC_EXPORT Reference {
     template <class T> friend class Let;
+    template <class T> friend class LocalLet;
+    template <class T> friend class WeakLet;
 
   protected:
+    explicit Reference() : _refcount(0), _local(false), _weak(nullptr) { }
     virtual ~Reference() { }
 
-    virtual int AddRef() const = 0;
-    virtual int RemoveRef() const = 0;
-    virtual int RefCount() const = 0;
+    // Taking a new reference needs no ordering, it is always made from an
+    // existing one. Dropping a reference releases our writes and the final
+    // drop acquires everyone else's before the object is deleted.
+
+    inline int AddRef() const {
+      if (_local) {
+        int res = _refcount.load(std::memory_order_relaxed) + 1;
+        _refcount.store(res, std::memory_order_relaxed);
+        return res;
+      }
+
+      return _refcount.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    inline int RemoveRef() const {
+      int res;
+
+      if (_local) {
+        res = _refcount.load(std::memory_order_relaxed) - 1;
+        _refcount.store(res, std::memory_order_relaxed);
+      } else {
+        res = _refcount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+      }
+
+      if (!res) {
+        Reference::Expire();
+        delete this;
+      }
+
+      return res;
+    }
+
+    inline int RefCount() const {
+      return _refcount.load(std::memory_order_acquire);
+    }
+
+    // Takes a reference only if the object is still alive.
+
+    inline bool TryAddRef() const {
+      int res = _refcount.load(std::memory_order_relaxed);
+
+      if (_local) {
+        if (res) { _refcount.store(res + 1, std::memory_order_relaxed); }
+        return (res > 0);
+      }
+
+      while (res > 0) {
+        if (_refcount.compare_exchange_weak(res, res + 1, std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    // Drops a reference unless it is the last one. Lets an object give up
+    // the reference it holds on itself without deleting itself.
+
+    inline bool TryRemoveRef() const {
+      int res = _refcount.load(std::memory_order_relaxed);
+
+      if (_local) {
+        if (res > 1) { _refcount.store(res - 1, std::memory_order_relaxed); }
+        return (res > 1);
+      }
+
+      while (res > 1) {
+        if (_refcount.compare_exchange_weak(res, res - 1, std::memory_order_acq_rel)) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+  private:
+
+    // Shared by the object and every WeakLet pointing at it. The object
+    // holds one reference to the block until it is deleted, the lock keeps
+    // the object alive while a WeakLet is trying to revive it.
+
+    class Weak {
+      public:
+        explicit Weak(const Reference *object) : _object(object), _refcount(1) {
+          _lock.clear();
+        }
+
+        inline void AddRef() {
+          _refcount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        inline void RemoveRef() {
+          if (_refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+          }
+        }
+
+        inline bool Lock() {
+          bool res = false;
+
+          while (_lock.test_and_set(std::memory_order_acquire)) { }
+
+          if (_object) {
+            res = _object->TryAddRef();
+          }
+
+          _lock.clear(std::memory_order_release);
+          return res;
+        }
+
+        inline void Expire() {
+          while (_lock.test_and_set(std::memory_order_acquire)) { }
+          _object = nullptr;
+          _lock.clear(std::memory_order_release);
+        }
+
+        inline bool Expired() {
+          while (_lock.test_and_set(std::memory_order_acquire)) { }
+          bool res = (_object == nullptr);
+          _lock.clear(std::memory_order_release);
+          return res;
+        }
+
+      private:
+        const Reference *_object;
+        std::atomic<int> _refcount;
+        std::atomic_flag _lock;
+    };
+
+    inline Weak *GetWeak() const {
+      Weak *weak = _weak.load(std::memory_order_acquire);
+
+      if (!weak) {
+        Weak *block = new Weak(this);
+
+        if (_weak.compare_exchange_strong(weak, block, std::memory_order_acq_rel)) {
+          weak = block;
+        } else {
+          delete block;
+        }
+      }
+
+      weak->AddRef();
+      return weak;
+    }
+
+    inline void Expire() const {
+      Weak *weak = _weak.load(std::memory_order_acquire);
+
+      if (weak) {
+        weak->Expire();
+        weak->RemoveRef();
+      }
+    }
+
+    mutable std::atomic<int> _refcount;
+    bool _local;
+    mutable std::atomic<Weak*> _weak;
+};
+
+/// Let<T> for objects that never leave the Worker (thread) that created them.
+/// Reference counting is done without atomic read-modify-write operations,
+/// so LocalLet objects must not be shared with other threads.
+
+template <class T> class LocalLet : public Let<T> {
+  public:
+    template <typename... Args> inline static LocalLet<T> New(Args&&... args) {
+      T* ptr = new typename Let<T>::template Constructor<Args...>(std::forward<Args>(args)...);
+      static_cast<Reference*>(ptr)->_local = true;
+      return LocalLet<T>(ptr);
+    }
+
+    inline explicit LocalLet() : Let<T>() { }
+    inline LocalLet(T* ptr) : Let<T>(ptr) { }
+};
+
+/// Non-owning reference to a Let<T>. Handlers stored on an object should capture
+/// a WeakLet of it (or of its peers) instead of a Let to avoid reference cycles.
+/// Lock() returns the object while it is still alive and an empty Let after that.
+
+template <class T> class WeakLet {
+  public:
+    inline explicit WeakLet() : _ptr(nullptr), _weak(nullptr) { }
+
+    inline WeakLet(const Let<T> &src) : _ptr(*src), _weak(nullptr) {
+      if (_ptr) {
+        _weak = static_cast<const Reference*>(_ptr)->GetWeak();
+      }
+    }
+
+    inline WeakLet(const WeakLet<T> &src) : _ptr(src._ptr), _weak(src._weak) {
+      if (_weak) { _weak->AddRef(); }
+    }
+
+    inline WeakLet(WeakLet<T> &&src) noexcept : _ptr(src._ptr), _weak(src._weak) {
+      src._ptr = nullptr;
+      src._weak = nullptr;
+    }
+
+    inline ~WeakLet() {
+      WeakLet::Dispose();
+    }
+
+    inline WeakLet<T> &operator=(const WeakLet<T> &src) {
+      if (src._weak) { src._weak->AddRef(); }
+
+      WeakLet::Dispose();
+
+      _ptr = src._ptr;
+      _weak = src._weak;
+      return *this;
+    }
+
+    inline WeakLet<T> &operator=(WeakLet<T> &&src) noexcept {
+      if (this != &src) {
+        WeakLet::Dispose();
+
+        _ptr = src._ptr;
+        _weak = src._weak;
+        src._ptr = nullptr;
+        src._weak = nullptr;
+      }
+
+      return *this;
+    }
+
+    inline WeakLet<T> &operator=(const Let<T> &src) {
+      return *this = WeakLet<T>(src);
+    }
+
+    inline Let<T> Lock() const {
+      Let<T> res;
+
+      if (_weak && _weak->Lock()) {
+        res._ptr = _ptr;
+      }
+
+      return res;
+    }
+
+    inline bool IsEmpty() const { return (_weak == nullptr); }
+    inline bool Expired() const { return (!_weak || _weak->Expired()); }
+
+    inline void Dispose() {
+      if (_weak) {
+        Reference::Weak *weak = _weak;
+        _ptr = nullptr;
+        _weak = nullptr;
+
+        weak->RemoveRef();
+      }
+    }
+
+  private:
+    T* _ptr;
+    Reference::Weak *_weak;
 };
 
 /*
@@ -252,50 +559,248 @@ template <typename R, typename... Args> class CRTC_EXPORT Functor<R(Args...)> {
       kOnce = 1 << 2,
     };
 
-    explicit Functor() : _flags(kNone) { }
-    virtual ~Functor() { }
+    explicit Functor() : _flags(kNone), _ops(nullptr), _calls(0), _next(nullptr) { }
 
-    Functor(const Functor<R(Args...)> &functor, const Functor<void()> &notifier) : _flags(kOnce), _callback(Let<VerifyWrap<void>>::New(functor, notifier)) { }
-    Functor(const Functor<R(Args...)> &functor) : _flags(functor._flags), _callback(functor._callback) { }
-    Functor(Functor&& functor) : _flags(functor._flags), _callback(std::move(functor._callback)) { }
+    virtual ~Functor() {
+      delete _next;
+      _next = nullptr;
+      _calls = 0;
 
-    template <class T> inline Functor(const T& functor, Flags flags = kNone) : _flags(flags), _callback(Let<Wrap<T> >::New(functor)) { }
-    template <class Object, class Method> inline Functor(Object *object, const Method& method, Flags flags = kNone) : _flags(flags), _callback(Let<ObjectWrap<Object, Method> >::New(object, method)) { }
-    template <class Object, class Method> inline Functor(const Let<Object> &object, const Method& method, Flags flags = kNone) : _flags(flags), _callback(Let<LetWrap<Object, Method> >::New(object, method)) { }
+      Functor::Reset();
+    }
+
+    Functor(const Functor<R(Args...)> &functor, const Functor<void()> &notifier) : _flags(kOnce), _ops(nullptr), _calls(0), _next(nullptr) {
+      Functor::Emplace(LetWrap<Callback, R (Callback::*)(Args&&...) const>(Let<VerifyWrap<void>>::New(functor, notifier), &Callback::Call));
+    }
+
+    Functor(const Functor<R(Args...)> &functor) : _flags(kNone), _ops(nullptr), _calls(0), _next(nullptr) {
+      Functor::Copy(functor);
+    }
+
+    Functor(Functor&& functor) noexcept : _flags(kNone), _ops(nullptr), _calls(0), _next(nullptr) {
+      Functor::Move(functor);
+    }
+
+    template <class T> inline Functor(const T& functor, Flags flags = kNone) : _flags(flags), _ops(nullptr), _calls(0), _next(nullptr) {
+      Functor::Assign(functor);
+    }
+
+    template <class Object, class Method> inline Functor(Object *object, const Method& method, Flags flags = kNone) : _flags(flags), _ops(nullptr), _calls(0), _next(nullptr) {
+      Functor::Assign(ObjectWrap<Object, Method>(object, method));
+    }
+
+    template <class Object, class Method> inline Functor(const Let<Object> &object, const Method& method, Flags flags = kNone) : _flags(flags), _ops(nullptr), _calls(0), _next(nullptr) {
+      Functor::Assign(LetWrap<Object, Method>(object, method));
+    }
+
+    template <class Object, class Method> inline Functor(const WeakLet<Object> &object, const Method& method, Flags flags = kNone) : _flags(flags), _ops(nullptr), _calls(0), _next(nullptr) {
+      Functor::Assign(WeakWrap<Object, Method>(object, method));
+    }
 
     inline R operator()(Args... args) const {
-      if (!_callback.IsEmpty()) {
-        Let<Callback> callback = _callback;
+      if (_next) {
+        return (*_next)(std::move(args)...);
+      }
 
-        if (_flags & kOnce) {
-          _callback.Dispose();
-        }
+      if (!_ops) {
+        return R();
+      }
 
-        return callback->Call(std::move(args)...);
+      if (_flags & kOnce) {
+        Functor<R(Args...)> callback;
+        callback.Move(*this);
+        return callback._ops->call(&callback._storage, std::move(args)...);
       }
 
-      return R();
+      Scope scope(this);
+      return _ops->call(&_storage, std::move(args)...);
     }
 
     inline Functor<R(Args...)>& operator=(const Functor<R(Args...)> &functor) {
-      _flags = functor._flags;
-      _callback = std::move(functor._callback);
+      if (this != &functor) {
+        if (_calls) {
+          Functor::Defer(Functor<R(Args...)>(functor));
+        } else {
+          Functor::Reset();
+          Functor::Copy(functor);
+        }
+      }
+
+      return *this;
+    }
+
+    inline Functor<R(Args...)>& operator=(Functor<R(Args...)> &&functor) noexcept {
+      if (this != &functor) {
+        if (_calls) {
+          Functor::Defer(std::move(functor));
+        } else {
+          Functor::Reset();
+          Functor::Move(functor);
+        }
+      }
+
       return *this;
     }
 
     inline bool IsEmpty() const {
-      return _callback.IsEmpty();
+      return (_next) ? _next->IsEmpty() : (_ops == nullptr);
     }
 
     operator bool() const {
-      return !_callback.IsEmpty();
+      return !Functor::IsEmpty();
     }
 
     inline void Dispose() const {
-      _callback.Dispose();
+      if (_calls) {
+        Functor::Defer(Functor<R(Args...)>());
+      } else {
+        Functor::Reset();
+      }
     }
 
   private:
+    // Functors up to four pointers in size are stored inline, anything larger
+    // (and the shared VerifyWrap) is kept as a Let<Callback> in the same buffer.
+    // Calls run on the stored callable. A callback may reassign or dispose the
+    // Functor that is invoking it: the new value waits in _next until the
+    // outermost call returns, and until then it is what the Functor holds.
+    // A kOnce callable is moved out before it runs. The Functor itself must
+    // outlive its calls, and one Functor is not called from several threads
+    // at once.
+
+    typedef typename std::aligned_storage<4 * sizeof(void*), alignof(void*)>::type Storage;
+
+    typedef struct {
+      R (*call)(const void *storage, Args&&... args);
+      void (*copy)(void *storage, const void *src);
+      void (*move)(void *storage, void *src);
+      void (*destroy)(void *storage);
+    } Operations;
+
+    template <class T> class Inline {
+      public:
+        static R Call(const void *storage, Args&&... args) {
+          return (*static_cast<const T*>(storage))(std::forward<Args>(args)...);
+        }
+
+        static void Copy(void *storage, const void *src) {
+          new (storage) T(*static_cast<const T*>(src));
+        }
+
+        static void Move(void *storage, void *src) {
+          new (storage) T(std::move(*static_cast<T*>(src)));
+        }
+
+        static void Destroy(void *storage) {
+          static_cast<T*>(storage)->~T();
+        }
+
+        static const Operations *Get() {
+          static const Operations operations = { &Inline::Call, &Inline::Copy, &Inline::Move, &Inline::Destroy };
+          return &operations;
+        }
+    };
+
+    template <class T> class Fits {
+      public:
+        static const bool value = (sizeof(T) <= sizeof(Storage) &&
+                                   alignof(Storage) % alignof(T) == 0 &&
+                                   std::is_nothrow_move_constructible<T>::value);
+    };
+
+    class Scope {
+      public:
+        explicit Scope(const Functor<R(Args...)> *functor) : _functor(functor) {
+          _functor->_calls++;
+        }
+
+        ~Scope() {
+          if (!--_functor->_calls && _functor->_next) {
+            _functor->Settle();
+          }
+        }
+
+      private:
+        const Functor<R(Args...)> *_functor;
+    };
+
+    inline void Defer(Functor<R(Args...)> &&functor) const {
+      if (_next) {
+        *_next = std::move(functor);
+      } else {
+        _next = new Functor<R(Args...)>(std::move(functor));
+      }
+    }
+
+    inline void Settle() const {
+      Functor<R(Args...)> *next = _next;
+      _next = nullptr;
+
+      Functor::Reset();
+      Functor::Move(*next);
+      delete next;
+    }
+
+    template <class T> inline void Emplace(const T &functor) {
+      new (&_storage) T(functor);
+      _ops = Inline<T>::Get();
+    }
+
+    template <class T> inline void Assign(const T &functor) {
+      typedef typename std::decay<T>::type Type;
+      Functor::Assign<Type>(functor, std::integral_constant<bool, Fits<Type>::value>());
+    }
+
+    template <class T> inline void Assign(const T &functor, std::true_type) {
+      Functor::Emplace<T>(functor);
+    }
+
+    template <class T> inline void Assign(const T &functor, std::false_type) {
+      Functor::Emplace(LetWrap<Callback, R (Callback::*)(Args&&...) const>(Let<Wrap<T>>::New(functor), &Callback::Call));
+    }
+
+    inline void Copy(const Functor<R(Args...)> &functor) const {
+      if (functor._next) {
+        return Functor::Copy(*functor._next);
+      }
+
+      _flags = functor._flags;
+
+      if (functor._ops) {
+        functor._ops->copy(&_storage, &functor._storage);
+        _ops = functor._ops;
+      }
+    }
+
+    // A callable that is running stays where it is, its copy is taken instead.
+
+    inline void Move(const Functor<R(Args...)> &functor) const noexcept {
+      if (functor._next) {
+        return Functor::Move(*functor._next);
+      }
+
+      if (functor._calls) {
+        Functor::Copy(functor);
+        return functor.Dispose();
+      }
+
+      _flags = functor._flags;
+
+      if (functor._ops) {
+        functor._ops->move(&_storage, &functor._storage);
+        _ops = functor._ops;
+        functor.Reset();
+      }
+    }
+
+    inline void Reset() const {
+      if (_ops) {
+        const Operations *ops = _ops;
+        _ops = nullptr;
+        ops->destroy(&_storage);
+      }
+    }
+
     class Callback : virtual public Reference {
         CRTC_PRIVATE(Callback);
         friend class Let<Callback>;
@@ -324,12 +829,11 @@ template <typename R, typename... Args> class CRTC_EXPORT Functor<R(Args...)> {
         T _functor;
     };
 
-    template <class Object, class Method> class ObjectWrap : public Callback {
-        CRTC_PRIVATE(ObjectWrap);
-        friend class Let<ObjectWrap>;
-
+    template <class Object, class Method> class ObjectWrap {
       public:
-        inline R Call(Args&&... args) const override {
+        explicit ObjectWrap(Object *object, const Method &method) : _object(object), _method(method) { }
+
+        inline R operator()(Args&&... args) const {
           if (_object) {
             return (_object->*_method)(std::forward<Args>(args)...);
           }
@@ -338,19 +842,15 @@ template <typename R, typename... Args> class CRTC_EXPORT Functor<R(Args...)> {
         }
 
       protected:
-        explicit ObjectWrap(Object *object, const Method &method) : _object(object), _method(method) { }
-        ~ObjectWrap() override { }
-
         Object* _object;
         Method _method;
     };
 
-    template <class Object, class Method> class LetWrap : public Callback {
-        CRTC_PRIVATE(LetWrap);
-        friend class Let<LetWrap>;
-
+    template <class Object, class Method> class LetWrap {
       public:
-        inline R Call(Args&&... args) const override {
+        explicit LetWrap(const Let<Object> &object, const Method &method) : _object(object), _method(method) { }
+
+        inline R operator()(Args&&... args) const {
           if (!_object.IsEmpty()) {
             return (_object->*_method)(std::forward<Args>(args)...);
           }
@@ -359,13 +859,29 @@ template <typename R, typename... Args> class CRTC_EXPORT Functor<R(Args...)> {
         }
 
       protected:
-        explicit LetWrap(const Let<Object> &object, const Method &method) : _object(object), _method(method) { }
-        ~LetWrap() override { }
-
         Let<Object> _object;
         Method _method;
     };
 
+    template <class Object, class Method> class WeakWrap {
+      public:
+        explicit WeakWrap(const WeakLet<Object> &object, const Method &method) : _object(object), _method(method) { }
+
+        inline R operator()(Args&&... args) const {
+          Let<Object> object = _object.Lock();
+
+          if (!object.IsEmpty()) {
+            return (object->*_method)(std::forward<Args>(args)...);
+          }
+
+          return R();
+        }
+
+      protected:
+        WeakLet<Object> _object;
+        Method _method;
+    };
+
     template <class Type = void> class VerifyWrap : public Callback {
         CRTC_PRIVATE(VerifyWrap);
         friend class Let<VerifyWrap>;
@@ -387,8 +903,11 @@ template <typename R, typename... Args> class CRTC_EXPORT Functor<R(Args...)> {
         Functor<Type()> _notifier;
     };
 
-    Flags _flags;
-    Let<Callback> _callback;
+    mutable Flags _flags;
+    mutable const Operations *_ops;
+    mutable Storage _storage;
+    mutable uint32_t _calls;
+    mutable Functor<R(Args...)> *_next;
 };
 
 typedef Functor<void()> Callback;
@@ -396,32 +915,222 @@ typedef Functor<void()> Callback;
 class CRTC_EXPORT Worker : virtual public Reference {
     CRTC_PRIVATE(Worker);
   public:
+    /// Lane of a task, see Async::Call().
+
+    enum Priority {
+      kRealtime,      // frame handoff, audio pushes
+      kNormal,
+      kBackground,    // stats, logging, file writes
+    };
+
+    static const int kPriorities = 3;
+
+    /// Bucket 0 of a histogram counts zeros, bucket n values in [2^(n-1), 2^n).
+
+    static const int kBuckets = 20;
+
+    typedef struct {
+      uint64_t tasks;               // tasks that ran
+      uint64_t expired;             // tasks dropped after their deadline
+      uint64_t delay[kBuckets];     // time from Async::Call() to run in microseconds, every
+                                    // realtime task but only one in eight of the others
+    } LaneStats;
+
+    typedef struct {
+      LaneStats lanes[kPriorities];
+      uint64_t depth;               // tasks queued when sampled
+      uint64_t runtime[kBuckets];   // run time of the timed tasks in microseconds
+      uint64_t busy;                // microseconds spent running since the thread started
+      uint64_t uptime;              // microseconds since the thread started
+    } WorkerStats;
+
+    /// Upper bound of the bucket of histogram that holds the given percentile
+    /// (0 - 100) of its samples, e.g. Percentile(stats.runtime, 99).
+
+    static uint64_t Percentile(const uint64_t (&histogram)[kBuckets], double percentile);
+
+    enum SchedulingPolicy {
+      kPolicyDefault,       // inherited from the creating thread
+      kPolicyOther,         // time sharing, priority is the nice value (-20 - 19)
+      kPolicyBatch,         // time sharing for throughput, priority is the nice value
+      kPolicyIdle,          // runs only when nothing else wants the core
+      kPolicyFifo,          // realtime (priority 1 - 99), needs privileges
+      kPolicyRoundRobin,    // realtime with time slices (priority 1 - 99), needs privileges
+    };
+
+    /// Settings of a thread. Affinity, stackSize and the time sharing policies
+    /// apply on Linux, the realtime policies on every POSIX system. A setting
+    /// the system refuses is left as is.
+
+    typedef struct WorkerOptions {
+      WorkerOptions() :
+        policy(kPolicyDefault),
+        priority(0),
+        stackSize(0)
+      { }
+
+      std::string name;               // thread name, pools append the index
+      std::vector<int> affinity;      // cores the thread may run on, any when empty
+      SchedulingPolicy policy;
+      int priority;
+      size_t stackSize;               // bytes, system default when 0
+    } WorkerOptions;
+
     static Let<Worker> New(const Callback &runnable = Callback());
+    static Let<Worker> New(const WorkerOptions &options, const Callback &runnable = Callback());
+
+    /// Creates a pool of threads, one per core when threads is 0. Threads take
+    /// tasks from each other when idle, so tasks posted to a pool run in no
+    /// particular order. Use Key() for tasks that have to stay in order.
+
+    static Let<Worker> NewPool(int threads = 0);
+    static Let<Worker> NewPool(int threads, const WorkerOptions &options);
     static Let<Worker> This();
+
+    /// Returns the worker that runs every task posted to it for key in order,
+    /// e.g. key per data channel. A pool picks one of its threads, a single
+    /// thread worker returns itself.
+
+    virtual Let<Worker> Key(uint64_t key) = 0;
+
+    enum WatchEvents {
+      kReadable = 1,
+      kWritable = 2,
+      kError = 4,     // hangup or error, reported without asking
+    };
+
+    typedef Functor<void(int fd, int events)> WatchCallback;
+
+    /// Calls callback on the worker thread as long as the non-blocking fd is
+    /// ready for events, watching fd again replaces them and the callback.
+    /// A pool watches fd on Key(fd). Returns false if fd can not be watched,
+    /// always on platforms other than Linux.
+
+    virtual bool Watch(int fd, int events, const WatchCallback &callback) = 0;
+
+    /// Call before closing fd. Called from another thread the callback may
+    /// still run once.
+
+    virtual void Unwatch(int fd) = 0;
+
+    /// Counters are sampled without locking the worker, a pool sums its
+    /// threads. busy / uptime is the busy ratio of the worker.
+
+    virtual WorkerStats Stats() const = 0;
+
   protected:
     explicit Worker() { }
     ~Worker() override { }
 };
 
+/// Calls runnable every interval_ms on a high priority thread. Clocks share a
+/// few threads, a runnable that blocks delays the other clocks of its thread.
+
 class CRTC_EXPORT RealTimeClock : virtual public Reference {
     CRTC_PRIVATE(RealTimeClock);
   public:
-    static Let<RealTimeClock> New(const Callback &runnable = Callback());
+    enum Policy {
+      kSkip,      // ticks that were missed completely are dropped
+      kCatchUp,   // missed ticks run back to back until the clock is on time again
+    };
+
+    /// Bucket 0 of a histogram counts zeros, bucket n values in [2^(n-1), 2^n).
+
+    static const int kBuckets = 20;
+
+    typedef struct {
+      uint64_t ticks;               // runnable calls
+      uint64_t overruns;            // calls that took longer than the interval
+      uint64_t missed;              // ticks dropped by kSkip
+      uint64_t jitter[kBuckets];    // lateness of each call in microseconds
+      uint64_t overrun[kBuckets];   // time past the interval of each overrun in microseconds
+      uint64_t skipped[kBuckets];   // ticks dropped at once
+    } ClockStats;
+
+    /// Ticks follow an absolute schedule from the first one, a late tick does
+    /// not move the ones after it.
+
+    static Let<RealTimeClock> New(const Callback &runnable = Callback(), Policy policy = kSkip);
 
     virtual void Start(uint32_t interval_ms = 0) = 0;
+
+    /// Once Stop() returns runnable is not running, unless Stop() was called from it.
+
     virtual void Stop() = 0;
 
+    virtual ClockStats Stats() const = 0;
+
   protected:
     explicit RealTimeClock() { }
     ~RealTimeClock() override { }
 };
 
+class AbortSignal;
+
+/// Handle of a timer started by SetTimeout() or SetInterval().
+
+class CRTC_EXPORT Timer : virtual public Reference {
+    CRTC_PRIVATE(Timer);
+  public:
+
+    /// Runs callback on worker after delay milliseconds, and again every interval
+    /// milliseconds if interval is set. Timers of a worker share a timing wheel,
+    /// starting and clearing one is O(1).
+
+    static Let<Timer> New(const Callback &callback, int delay, int interval = 0, const Let<Worker> &worker = Worker::This());
+
+    /// Same as above, but aborting signal clears the timer.
+
+    static Let<Timer> New(const Callback &callback, int delay, int interval, const Let<Worker> &worker, const Let<AbortSignal> &signal);
+
+    /// Releases the callback without invoking it again. Can be called from any thread.
+
+    virtual void Clear() = 0;
+
+  protected:
+    explicit Timer() { }
+    ~Timer() override { }
+};
+
 class CRTC_EXPORT Async {
     CRTC_STATIC(Async);
   public:
-    static void Call(Callback callback, int delay = 0, Let<Worker> worker = Worker::This());
+    /// Once signal is aborted a callback that has not run yet is released without being invoked.
+
+    static void Call(Callback callback, int delay = 0, Let<Worker> worker = Worker::This(), Let<AbortSignal> signal = Let<AbortSignal>());
+
+    /// Posts callback to the lane of priority on worker. Higher lanes run first,
+    /// but every fourth task comes from kNormal and every sixteenth from
+    /// kBackground while they have work. A callback that has not started
+    /// deadline ms after the call is released without being invoked. Other
+    /// threads than workers ignore both.
+
+    static void Call(Callback callback, Worker::Priority priority, int deadline = 0, Let<Worker> worker = Worker::This(), Let<AbortSignal> signal = Let<AbortSignal>());
+
+    /// Runs callback right after the task currently running on worker, before
+    /// anything else queued to it. Falls back to Call() for other threads.
+
+    static void Queue(Callback callback, Let<Worker> worker = Worker::This());
+
+    /// Runs callback on the thread that called Module::Init() from
+    /// Module::DispatchEvents(), right after the current task when called
+    /// from that thread. Can be called from any thread.
+
+    static void Dispatch(Callback callback);
 };
 
+/// \sa https://developer.mozilla.org/en-US/docs/Web/API/queueMicrotask
+
+template <typename F, typename... Args> static inline void QueueMicrotask(F&& func, Args... args) {
+  Functor<void(Args...)> callback(func);
+
+  Async::Queue(Callback([=]() {
+    callback(args...);
+  }, [=]() {
+    callback(args...);
+  }));
+}
+
 /// \sa https://developer.mozilla.org/en/docs/Web/API/Window/SetImmediate
 
 template <typename F, typename... Args> static inline void SetImmediate(F&& func, Args... args) {
@@ -434,54 +1143,249 @@ template <typename F, typename... Args> static inline void SetImmediate(F&& func
   }));
 }
 
-/// \sa https://developer.mozilla.org/en-US/docs/Web/API/WindowTimers/setTimeout
+template <typename F, typename... Args> static inline void SetImmediate(Let<AbortSignal> signal, F&& func, Args... args) {
+  Functor<void(Args...)> callback(func);
+
+  Async::Call(Callback([=]() {
+    callback(args...);
+  }), 0, Worker::This(), signal);
+}
+
+/// \sa https://developer.mozilla.org/en-US/docs/Web/API/WindowTimers/setTimeout
+
+template <typename F, typename... Args> static inline Let<Timer> SetTimeout(F&& func, int delay, Args... args) {
+  Functor<void(Args... args)> callback(func);
+
+  return Timer::New(Callback([=]() {
+    callback(args...);
+  }), delay);
+}
+
+template <typename F, typename... Args> static inline Let<Timer> SetTimeout(Let<AbortSignal> signal, F&& func, int delay, Args... args) {
+  Functor<void(Args... args)> callback(func);
+
+  return Timer::New(Callback([=]() {
+    callback(args...);
+  }), delay, 0, Worker::This(), signal);
+}
+
+/// \sa https://developer.mozilla.org/en-US/docs/Web/API/WindowOrWorkerGlobalScope/clearTimeout
+
+static inline void ClearTimeout(const Let<Timer> &timer) {
+  if (!timer.IsEmpty()) {
+    timer->Clear();
+  }
+}
+
+/// \sa https://developer.mozilla.org/en-US/docs/Web/API/WindowOrWorkerGlobalScope/setInterval
+
+template <typename F, typename... Args> static inline Let<Timer> SetInterval(F&& func, int delay, Args... args) {
+  Functor<void(Args... args)> callback(func);
+
+  return Timer::New(Callback([=]() {
+    callback(args...);
+  }), delay, (delay > 0) ? delay : 1);
+}
+
+/// \sa https://developer.mozilla.org/en-US/docs/Web/API/WindowOrWorkerGlobalScope/clearInterval
+
+static inline void ClearInterval(const Let<Timer> &timer) {
+  ClearTimeout(timer);
+}
+
+/// \sa https://developer.mozilla.org/en/docs/Web/JavaScript/Reference/Global_Objects/Error
+
+class CRTC_EXPORT Error : virtual public Reference {
+  public:
+    static Let<Error> New(std::string message, std::string fileName = __FILE__, int lineNumber = __LINE__);
+
+    virtual std::string Message() const = 0;
+    virtual std::string FileName() const = 0;
+    virtual int LineNumber() const = 0;
+
+    virtual std::string ToString() const = 0;
+
+  protected:
+    explicit Error() { }
+    ~Error() override { }
+};
+
+typedef Functor<void(const Let<Error> &error)> ErrorCallback;
+
+/// \sa https://developer.mozilla.org/en-US/docs/Web/API/AbortSignal
+
+class CRTC_EXPORT AbortSignal : virtual public Reference {
+    CRTC_PRIVATE(AbortSignal);
+  public:
+    static Let<AbortSignal> Timeout(int delay);
+
+    virtual bool Aborted() const = 0;
+    virtual Let<Error> Reason() const = 0;
+
+    /// Listeners get the reason on the thread calling Abort(), or right away when
+    /// already aborted. The returned id removes the listener again.
+
+    virtual int AddListener(const ErrorCallback &callback) = 0;
+    virtual void RemoveListener(int id) = 0;
+
+    Callback onabort;
+
+  protected:
+    explicit AbortSignal() { }
+    ~AbortSignal() override { }
+};
+
+/// \sa https://developer.mozilla.org/en-US/docs/Web/API/AbortController
+
+class CRTC_EXPORT AbortController : virtual public Reference {
+    CRTC_PRIVATE(AbortController);
+  public:
+    static Let<AbortController> New();
+
+    virtual Let<AbortSignal> Signal() const = 0;
+    virtual void Abort(const Let<Error> &reason = Let<Error>()) = 0;
+
+  protected:
+    explicit AbortController() { }
+    ~AbortController() override { }
+};
+
+/// \sa https://developer.mozilla.org/en/docs/Web/JavaScript/Reference/Global_Objects/Promise
+
+template <typename... Args> class Promise : virtual public Reference {
+    CRTC_PRIVATE(Promise);
+    friend class Let<Promise<Args...>>;
+    template <typename... S> friend class Promise;
+
+    template <class F> using Result = typename std::decay<decltype(std::declval<const F&>()(std::declval<Args>()...))>::type;
+
+    // Result types of the combinators, a promise without arguments joins
+    // into Promise<void> and a promise with several into std::tuple's.
+
+    template <class V, class D = void> struct Join {
+      typedef Promise<std::vector<V>> All;
+      typedef std::vector<V> Values;
+
+      typedef struct {
+        bool fulfilled;
+        V value;
+        Let<Error> reason;
+      } Settled;
+
+      template <class F> inline static void Resolve(const F &resolve, const Values &values) {
+        resolve(values);
+      }
+    };
+
+    template <class D> struct Join<void, D> {
+      typedef Promise<> All;
+
+      typedef struct {
+        inline void resize(size_t) { }
+      } Values;
+
+      typedef struct {
+        bool fulfilled;
+        Let<Error> reason;
+      } Settled;
+
+      template <class F> inline static void Resolve(const F &resolve, const Values &) {
+        resolve();
+      }
+    };
+
+    template <class D, typename... A> struct Outcome {
+      typedef std::tuple<typename std::decay<A>::type...> Value;
+
+      inline static void Store(typename Join<Value>::Values &values, size_t index, A... args) {
+        values[index] = Value(args...);
+      }
+
+      inline static void Settle(typename Join<Value>::Settled &settled, A... args) {
+        settled.value = Value(args...);
+      }
+    };
+
+    template <class D, typename A> struct Outcome<D, A> {
+      typedef typename std::decay<A>::type Value;
+
+      inline static void Store(typename Join<Value>::Values &values, size_t index, A arg) {
+        values[index] = arg;
+      }
+
+      inline static void Settle(typename Join<Value>::Settled &settled, A arg) {
+        settled.value = arg;
+      }
+    };
 
-template <typename F, typename... Args> static inline void SetTimeout(F&& func, int delay, Args... args) {
-  Functor<void(Args... args)> callback(func);
+    template <class D> struct Outcome<D> {
+      typedef void Value;
 
-  Async::Call(Callback([=]() {
-    callback(args...);
-  }, [=]() {
-    callback(args...);
-  }), (delay > 0) ? delay : 0);
-}
+      inline static void Store(typename Join<Value>::Values &, size_t) { }
+      inline static void Settle(typename Join<Value>::Settled &) { }
+    };
 
-/// \sa https://developer.mozilla.org/en/docs/Web/JavaScript/Reference/Global_Objects/Error
+    // Resolves the promise returned by Then() from the callback result,
+    // a returned promise is followed instead of being passed on as value.
 
-class CRTC_EXPORT Error : virtual public Reference {
-  public:
-    static Let<Error> New(std::string message, std::string fileName = __FILE__, int lineNumber = __LINE__);
+    template <class R, class D = void> struct Chain {
+      typedef Promise<R> Next;
 
-    virtual std::string Message() const = 0;
-    virtual std::string FileName() const = 0;
-    virtual int LineNumber() const = 0;
+      template <class F, class T> inline static void Call(const F &resolve, const ErrorCallback &, const T &callback) {
+        resolve(callback());
+      }
+    };
 
-    virtual std::string ToString() const = 0;
+    template <class D> struct Chain<void, D> {
+      typedef Promise<> Next;
 
-  protected:
-    explicit Error() { }
-    ~Error() override { }
-};
+      template <class F, class T> inline static void Call(const F &resolve, const ErrorCallback &, const T &callback) {
+        callback();
+        resolve();
+      }
+    };
 
-typedef Functor<void(const Let<Error> &error)> ErrorCallback;
+    template <class D, typename... V> struct Chain<Let<Promise<V...>>, D> {
+      typedef Promise<V...> Next;
 
-/// \sa https://developer.mozilla.org/en/docs/Web/JavaScript/Reference/Global_Objects/Promise
+      template <class F, class T> inline static void Call(const F &resolve, const ErrorCallback &reject, const T &callback) {
+        Let<Promise<V...>> promise = callback();
 
-template <typename... Args> class Promise : virtual public Reference {
-    CRTC_PRIVATE(Promise<Args...>);
-    friend class Let<Promise<Args...>>;
+        if (!promise.IsEmpty()) {
+          promise->OnResolve(resolve);
+          promise->OnReject(reject);
+        } else {
+          reject(Error::New("Invalid Promise.", __FILE__, __LINE__));
+        }
+      }
+    };
+
+    template <class D> struct Chain<Let<Promise<void>>, D> : public Chain<Let<Promise<>>, D> { };
+
+    typedef typename Outcome<void, Args...>::Value Value;
 
   public:
     typedef Functor<void(Args...)> FullFilledCallback;
     typedef Callback FinallyCallback;
     typedef ErrorCallback RejectedCallback;
     typedef Functor<void(const FullFilledCallback &resolve, const RejectedCallback &reject)> ExecutorCallback;
+    typedef typename Join<Value>::Settled Settled;
 
-    inline static Let<Promise<Args...>> New(const ExecutorCallback &executor, const Let<Worker> &worker = Worker::This()) {
+    /// Aborting signal rejects the promise with the signal's reason if it is still pending.
+
+    inline static Let<Promise<Args...>> New(const ExecutorCallback &executor, const Let<Worker> &pool = Worker::This(), const Let<AbortSignal> &signal = Let<AbortSignal>()) {
       Let<Promise<Args...>> self = Let<Promise<Args...>>::New();
 
+      // Settle on a single thread, even if a pool was given.
+
+      Let<Worker> worker = (!pool.IsEmpty()) ? pool->Key(reinterpret_cast<uintptr_t>(static_cast<Promise<Args...>*>(self))) : pool;
+
       RejectedCallback reject([=](const Let<Error> &error) {
-        if (!self.IsEmpty()) {
+        if (!self.IsEmpty() && self->_state == kPending) {
+          self->_state = kRejected;
+          self->_error = error;
+          self->Unsubscribe();
+
           for (const auto &callback: self->_onreject) {
             callback(error);
           }
@@ -499,18 +1403,25 @@ template <typename... Args> class Promise : virtual public Reference {
       });
 
       RejectedCallback asyncReject([=](const Let<Error> &error) {
-        Async::Call(Callback([=]() {
+        Async::Queue(Callback([=]() {
           reject(error);
         }, [=]() {
           reject(error);
-        }), 0, worker);
+        }), worker);
       });
 
       FullFilledCallback resolve([=](Args... args) {
-        Async::Call(Callback([=]() {
-          if (!self.IsEmpty()) {
+        Async::Queue(Callback([=]() {
+          if (!self.IsEmpty() && self->_state == kPending) {
+            self->_state = kFulfilled;
+            self->_value = [=](const FullFilledCallback &callback) {
+              callback(args...);
+            };
+
+            self->Unsubscribe();
+
             for (const auto &callback: self->_onresolve) {
-              callback(std::move(args)...);
+              callback(args...);
             }
 
             for (const auto &callback: self->_onfinally) {
@@ -525,11 +1436,23 @@ template <typename... Args> class Promise : virtual public Reference {
           }
         }, [=]() {
           asyncReject(Error::New("Reference Lost.", __FILE__, __LINE__));
-        }), 0, worker);
+        }), worker);
       }, [=]() {
         asyncReject(Error::New("Reference Lost.", __FILE__, __LINE__));
       });
 
+      if (!signal.IsEmpty()) {
+        if (signal->Aborted()) {
+          asyncReject(signal->Reason());
+          return self;
+        }
+
+        self->_signal = signal;
+        self->_listener = signal->AddListener([=](const Let<Error> &reason) {
+          asyncReject(reason);
+        });
+      }
+
       if (!executor.IsEmpty()) {
         executor(resolve, asyncReject);
       } else {
@@ -539,33 +1462,405 @@ template <typename... Args> class Promise : virtual public Reference {
       return self;
     }
 
-    inline Let<Promise<Args...>> Then(const FullFilledCallback &callback) {
-      _onresolve.push_back(callback);
-      return this;
+    /// Resolves with the values of all promises in order, or rejects with the first error.
+
+    template <class P> inline static Let<typename Join<Value>::All> All(const std::vector<Let<P>> &promises) {
+      typedef typename Join<Value>::All Joined;
+
+      class Shared : public Reference {
+        public:
+          typename Join<Value>::Values values;
+          std::atomic<size_t> pending;
+          typename Joined::FullFilledCallback resolve;
+          RejectedCallback reject;
+      };
+
+      Let<Shared> state = Let<Shared>::New();
+      Let<Joined> result = Joined::New([&](const typename Joined::FullFilledCallback &resolve, const RejectedCallback &reject) {
+        state->resolve = resolve;
+        state->reject = reject;
+      });
+
+      state->values.resize(promises.size());
+      state->pending.store(promises.size(), std::memory_order_relaxed);
+
+      if (promises.empty()) {
+        Join<Value>::Resolve(state->resolve, state->values);
+      }
+
+      for (size_t index = 0; index < promises.size(); index++) {
+        Promise<Args...> *promise = *promises[index];
+
+        if (!promise) {
+          state->reject(Error::New("Invalid Promise.", __FILE__, __LINE__));
+          continue;
+        }
+
+        promise->OnResolve([=](Args... args) {
+          Outcome<void, Args...>::Store(state->values, index, args...);
+
+          if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Join<Value>::Resolve(state->resolve, state->values);
+          }
+        });
+
+        promise->OnReject([=](const Let<Error> &error) {
+          state->reject(error);
+        });
+      }
+
+      return result;
     }
 
-    inline Let<Promise<Args...>> Catch(const RejectedCallback &callback) {
-      _onreject.push_back(callback);
+    /// Settles with the first promise that settles.
+
+    template <class P> inline static Let<Promise<Args...>> Race(const std::vector<Let<P>> &promises) {
+      class Shared : public Reference {
+        public:
+          FullFilledCallback resolve;
+          RejectedCallback reject;
+      };
+
+      Let<Shared> state = Let<Shared>::New();
+      Let<Promise<Args...>> result = Promise::New([&](const FullFilledCallback &resolve, const RejectedCallback &reject) {
+        state->resolve = resolve;
+        state->reject = reject;
+      });
+
+      for (size_t index = 0; index < promises.size(); index++) {
+        Promise<Args...> *promise = *promises[index];
+
+        if (!promise) {
+          state->reject(Error::New("Invalid Promise.", __FILE__, __LINE__));
+          continue;
+        }
+
+        promise->OnResolve([=](Args... args) {
+          state->resolve(args...);
+        });
+
+        promise->OnReject([=](const Let<Error> &error) {
+          state->reject(error);
+        });
+      }
+
+      return result;
+    }
+
+    /// Resolves once every promise has settled with the outcome of each, never rejects.
+
+    template <class P> inline static Let<Promise<std::vector<Settled>>> AllSettled(const std::vector<Let<P>> &promises) {
+      typedef Promise<std::vector<Settled>> Joined;
+
+      class Shared : public Reference {
+        public:
+          std::vector<Settled> values;
+          std::atomic<size_t> pending;
+          typename Joined::FullFilledCallback resolve;
+      };
+
+      Let<Shared> state = Let<Shared>::New();
+      Let<Joined> result = Joined::New([&](const typename Joined::FullFilledCallback &resolve, const RejectedCallback &) {
+        state->resolve = resolve;
+      });
+
+      state->values.resize(promises.size());
+      state->pending.store(promises.size(), std::memory_order_relaxed);
+
+      if (promises.empty()) {
+        state->resolve(state->values);
+      }
+
+      for (size_t index = 0; index < promises.size(); index++) {
+        Promise<Args...> *promise = *promises[index];
+
+        if (!promise) {
+          state->values[index].fulfilled = false;
+          state->values[index].reason = Error::New("Invalid Promise.", __FILE__, __LINE__);
+
+          if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            state->resolve(state->values);
+          }
+
+          continue;
+        }
+
+        promise->OnResolve([=](Args... args) {
+          state->values[index].fulfilled = true;
+          Outcome<void, Args...>::Settle(state->values[index], args...);
+
+          if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            state->resolve(state->values);
+          }
+        });
+
+        promise->OnReject([=](const Let<Error> &error) {
+          state->values[index].fulfilled = false;
+          state->values[index].reason = error;
+
+          if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            state->resolve(state->values);
+          }
+        });
+      }
+
+      return result;
+    }
+
+    /// Returns a new promise resolved with the result of callback. If callback
+    /// returns a promise the new one follows it, rejections are passed on.
+
+    template <class F> inline Let<typename Chain<Result<F>>::Next> Then(F callback) {
+      typedef typename Chain<Result<F>>::Next Next;
+
+      typename Next::FullFilledCallback resolve;
+      RejectedCallback reject;
+
+      Let<Next> next = Next::New([&](const typename Next::FullFilledCallback &res, const RejectedCallback &rej) {
+        resolve = res;
+        reject = rej;
+      });
+
+      Promise::OnResolve([=](Args... args) {
+        Chain<Result<F>>::Call(resolve, reject, [&]() {
+          return callback(args...);
+        });
+      });
+
+      Promise::OnReject(reject);
+      return next;
+    }
+
+    inline Let<Promise<Args...>> Catch(RejectedCallback callback) {
+      Promise::OnReject(std::move(callback));
       return this;
     }
 
-    inline Let<Promise<Args...>> Finally(const FinallyCallback &callback) {
-      _onfinally.push_back(callback);
+    inline Let<Promise<Args...>> Finally(FinallyCallback callback) {
+      if (_state != kPending) {
+        Async::Queue(std::move(callback));
+      } else {
+        _onfinally.push_back(std::move(callback));
+      }
+
       return this;
     }
 
+    /// Returns a promise settled like this one, or rejected when delay milliseconds pass first.
+
+    inline Let<Promise<Args...>> Timeout(int delay) {
+      FullFilledCallback resolve;
+      RejectedCallback reject;
+
+      Let<Promise<Args...>> next = Promise::New([&](const FullFilledCallback &res, const RejectedCallback &rej) {
+        resolve = res;
+        reject = rej;
+      });
+
+      Let<AbortController> timer = AbortController::New();
+
+      Async::Call(Callback([=]() {
+        reject(Error::New("Timeout.", __FILE__, __LINE__));
+      }), delay, Worker::This(), timer->Signal());
+
+      Promise::OnResolve([=](Args... args) {
+        timer->Abort();
+        resolve(args...);
+      });
+
+      Promise::OnReject([=](const Let<Error> &error) {
+        timer->Abort();
+        reject(error);
+      });
+
+      return next;
+    }
+
+#ifdef CRTC_HAS_COROUTINES
+    /// co_await support, resumes the coroutine on the worker it was suspended
+    /// on and yields the outcome as Settled instead of throwing. Coroutines
+    /// suspended on any other thread resume on the thread that called
+    /// Module::Init(), through Async::Dispatch().
+
+    class Awaiter {
+      public:
+        explicit Awaiter(const Let<Promise<Args...>> &promise) : _promise(promise), _worker(Worker::This()) { }
+
+        inline bool await_ready() const noexcept {
+          return _promise.IsEmpty();
+        }
+
+        inline void await_suspend(std::coroutine_handle<> handle) {
+          Awaiter *self = this;
+          Let<Worker> worker = _worker;
+
+          _promise->OnResolve([=](Args... args) {
+            self->_result.fulfilled = true;
+            Outcome<void, Args...>::Settle(self->_result, args...);
+            Awaiter::Resume(handle, worker);
+          });
+
+          _promise->OnReject([=](const Let<Error> &error) {
+            self->_result.fulfilled = false;
+            self->_result.reason = error;
+            Awaiter::Resume(handle, worker);
+          });
+        }
+
+        inline Settled await_resume() {
+          if (_promise.IsEmpty()) {
+            _result.fulfilled = false;
+            _result.reason = Error::New("Invalid Promise.", __FILE__, __LINE__);
+          }
+
+          return std::move(_result);
+        }
+
+      private:
+        inline static void Resume(std::coroutine_handle<> handle, const Let<Worker> &worker) {
+          Callback callback([=]() {
+            handle.resume();
+          });
+
+          if (worker.IsEmpty()) {
+            return Async::Dispatch(std::move(callback));
+          }
+
+          Async::Queue(std::move(callback), worker);
+        }
+
+        Let<Promise<Args...>> _promise;
+        Let<Worker> _worker;
+        Settled _result;
+    };
+#endif
+
   private:
+    enum State {
+      kPending,
+      kFulfilled,
+      kRejected,
+    };
+
+    // Callbacks added after the promise has settled are queued right away
+    // with the stored result.
+
+    inline void OnResolve(FullFilledCallback callback) {
+      if (_state == kPending) {
+        _onresolve.push_back(std::move(callback));
+      } else if (_state == kFulfilled) {
+        Let<Promise<Args...>> self(this);
+
+        Async::Queue(Callback([=]() {
+          self->_value(callback);
+        }));
+      }
+    }
+
+    inline void OnReject(RejectedCallback callback) {
+      if (_state == kPending) {
+        _onreject.push_back(std::move(callback));
+      } else if (_state == kRejected) {
+        Let<Error> error = _error;
+
+        Async::Queue(Callback([=]() {
+          callback(error);
+        }));
+      }
+    }
+
+    inline void Unsubscribe() {
+      if (!_signal.IsEmpty()) {
+        _signal->RemoveListener(_listener);
+        _signal.Dispose();
+      }
+    }
+
+    State _state;
+    Functor<void(const FullFilledCallback &callback)> _value;
+    Let<Error> _error;
+    Let<AbortSignal> _signal;
+    int _listener;
+
     std::vector<FullFilledCallback> _onresolve;
     std::vector<RejectedCallback> _onreject;
     std::vector<FinallyCallback> _onfinally;
 
   protected:
-    explicit Promise() { }
+    explicit Promise() : _state(kPending), _listener(0) { }
     ~Promise() override { }
 };
 
 template<> class Promise<void> : public Promise<> { };
 
+#ifdef CRTC_HAS_COROUTINES
+template <typename... Args> inline typename Promise<Args...>::Awaiter operator co_await(const Let<Promise<Args...>> &promise) {
+  return typename Promise<Args...>::Awaiter(promise);
+}
+
+inline Promise<>::Awaiter operator co_await(const Let<Promise<void>> &promise) {
+  return Promise<>::Awaiter(promise);
+}
+
+template <class T> class TaskPromise {
+  public:
+    typedef Promise<T> Type;
+
+    inline void return_value(T value) {
+      _resolve(std::move(value));
+    }
+
+  protected:
+    typename Type::FullFilledCallback _resolve;
+};
+
+template <> class TaskPromise<void> {
+  public:
+    typedef Promise<> Type;
+
+    inline void return_void() {
+      _resolve();
+    }
+
+  protected:
+    Type::FullFilledCallback _resolve;
+};
+
+/// Coroutine type, the body runs right away on the calling worker and the
+/// co_return value resolves the underlying promise.
+/// \sa https://developer.mozilla.org/en-US/docs/Web/JavaScript/Reference/Statements/async_function
+
+template <class T = void> class Task {
+  public:
+    typedef typename TaskPromise<T>::Type Type;
+
+    class promise_type : public TaskPromise<T> {
+      public:
+        inline Task<T> get_return_object() {
+          return Task<T>(Type::New([this](const typename Type::FullFilledCallback &resolve, const typename Type::RejectedCallback &) {
+            this->_resolve = resolve;
+          }));
+        }
+
+        inline std::suspend_never initial_suspend() noexcept { return {}; }
+        inline std::suspend_never final_suspend() noexcept { return {}; }
+        inline void unhandled_exception() { std::terminate(); }
+    };
+
+    inline operator Let<Type>() const { return _promise; }
+    inline Type* operator->() const { return *_promise; }
+
+    inline typename Type::Awaiter operator co_await() const {
+      return typename Type::Awaiter(_promise);
+    }
+
+  private:
+    explicit Task(const Let<Type> &promise) : _promise(promise) { }
+
+    Let<Type> _promise;
+};
+#endif
+
 /// \sa https://developer.mozilla.org/en/docs/Web/JavaScript/Reference/Global_Objects/ArrayBuffer
 
 class CRTC_EXPORT ArrayBuffer : virtual public Reference {
@@ -576,10 +1871,35 @@ class CRTC_EXPORT ArrayBuffer : virtual public Reference {
     static Let<ArrayBuffer> New(const std::string &data);
     static Let<ArrayBuffer> New(const uint8_t *data, size_t byteLength = 0);
 
+    /// Called once with the memory of an adopted buffer when the buffer is
+    /// destroyed.
+
+    typedef Functor<void(uint8_t *data, size_t byteLength)> Deleter;
+
+    /// Wraps memory without copying it. The buffer owns data from now on and
+    /// hands it to deleter when it is destroyed, an empty deleter leaves data
+    /// alone.
+
+    static Let<ArrayBuffer> Adopt(uint8_t *data, size_t byteLength, const Deleter &deleter = Deleter());
+
+    /// Wraps memory that belongs to owner without copying it. Owner is kept
+    /// alive for as long as the buffer is.
+
+    template <class T> static inline Let<ArrayBuffer> Borrow(uint8_t *data, size_t byteLength, const Let<T> &owner) {
+      return ArrayBuffer::Adopt(data, byteLength, [owner](uint8_t *, size_t) { });
+    }
+
     virtual size_t ByteLength() const = 0;
 
+    /// Returns a view of begin to end that shares memory with this buffer
+    /// and keeps it alive, writes to either one are seen by both.
+
     virtual Let<ArrayBuffer> Slice(size_t begin = 0, size_t end = 0) const = 0;
 
+    /// Returns a copy of begin to end in memory of its own.
+
+    virtual Let<ArrayBuffer> Copy(size_t begin = 0, size_t end = 0) const = 0;
+
     virtual uint8_t *Data() = 0;
     virtual const uint8_t *Data() const = 0;
 
@@ -590,6 +1910,39 @@ class CRTC_EXPORT ArrayBuffer : virtual public Reference {
     ~ArrayBuffer() override { }
 };
 
+/// Recycles the memory of large buffers. Sizes are rounded up to classes four
+/// per power of two from 1kB to 64MB, larger buffers come straight from the
+/// system. Each thread keeps up to four idle buffers per class and 16MB in
+/// total, the rest go to a shared pool that holds at most SetLimit() bytes.
+/// A buffer returns to the pool when its last reference is dropped.
+
+class CRTC_EXPORT BufferPool {
+    CRTC_STATIC(BufferPool);
+
+  public:
+    typedef struct {
+      size_t size;       // buffer size of the class in bytes
+      uint64_t allocs;   // total allocations
+      uint64_t frees;    // total releases
+      uint64_t hits;     // allocations served by a recycled buffer
+      uint64_t misses;   // allocations that took new memory from the system
+      size_t resident;   // bytes held by the class, in use and idle
+    } PoolStats;
+
+    /// Returns a buffer of byteLength bytes. Recycled memory holds whatever
+    /// it held before unless zeroFill is set.
+
+    static Let<ArrayBuffer> New(size_t byteLength, bool zeroFill = true);
+
+    /// Idle bytes the shared pool keeps, anything above is given back to the
+    /// system. Defaults to 64MB. Buffers cached by threads are not counted,
+    /// so idle memory can reach the limit plus 16MB for each thread that
+    /// releases buffers. A thread gives its cache to the pool when it exits.
+
+    static void SetLimit(size_t byteLength);
+    static std::vector<PoolStats> Stats();
+};
+
 /// \sa https://developer.mozilla.org/en-US/docs/Web/JavaScript/Reference/Global_Objects/TypedArray
 
 template <typename T> class CRTC_EXPORT TypedArray {
@@ -611,6 +1964,20 @@ template <typename T> class CRTC_EXPORT TypedArray {
       _buffer(typedArray._buffer)
     { }
 
+    TypedArray(TypedArray<T> &&typedArray) noexcept :
+      _empty(0),
+      _data(typedArray._data),
+      _length(typedArray._length),
+      _byteOffset(typedArray._byteOffset),
+      _byteLength(typedArray._byteLength), 
+      _buffer(std::move(typedArray._buffer))
+    {
+      typedArray._data = nullptr;
+      typedArray._length = 0;
+      typedArray._byteOffset = 0;
+      typedArray._byteLength = 0;
+    }
+
     template <typename N> TypedArray(const TypedArray<N> &typedArray) :
       TypedArray(typedArray.Buffer())
     { }
@@ -638,6 +2005,32 @@ template <typename T> class CRTC_EXPORT TypedArray {
       }
     }
 
+    inline TypedArray<T> &operator=(const TypedArray<T> &typedArray) {
+      _data = typedArray._data;
+      _length = typedArray._length;
+      _byteOffset = typedArray._byteOffset;
+      _byteLength = typedArray._byteLength;
+      _buffer = typedArray._buffer;
+      return *this;
+    }
+
+    inline TypedArray<T> &operator=(TypedArray<T> &&typedArray) noexcept {
+      if (this != &typedArray) {
+        _data = typedArray._data;
+        _length = typedArray._length;
+        _byteOffset = typedArray._byteOffset;
+        _byteLength = typedArray._byteLength;
+        _buffer = std::move(typedArray._buffer);
+
+        typedArray._data = nullptr;
+        typedArray._length = 0;
+        typedArray._byteOffset = 0;
+        typedArray._byteLength = 0;
+      }
+
+      return *this;
+    }
+
     inline size_t Length() const {
       return _length;
     }
@@ -662,6 +2055,14 @@ template <typename T> class CRTC_EXPORT TypedArray {
       return ArrayBuffer::New();
     }
 
+    inline Let<ArrayBuffer> Copy(size_t begin = 0, size_t end = 0) const {
+      if (_length) {
+        return _buffer->Copy(begin * sizeof(T), end * sizeof(T));
+      }
+
+      return ArrayBuffer::New();
+    }
+
     inline T *Data() {
       return (_length) ? _data : nullptr;
     }
@@ -747,8 +2148,44 @@ class CRTC_EXPORT Module {
     CRTC_STATIC(Module);
 
   public:
+    /// Options of the threads the library creates for itself. Realtime
+    /// clocks run at high priority unless clock says otherwise, their stack
+    /// size is fixed.
+
+    typedef struct {
+      Worker::WorkerOptions network;
+      Worker::WorkerOptions worker;
+      Worker::WorkerOptions clock;
+    } ModuleOptions;
+
     static void Init();
+    static void Init(const ModuleOptions &options);
     static bool DispatchEvents(bool kForever = false);
+
+    /// Runs at most maxTasks queued tasks of the calling thread and stops
+    /// taking new ones deadline_ms milliseconds after the call even if more
+    /// are queued, zero or less means no time limit. Returns the number of
+    /// tasks that ran.
+
+    static size_t DispatchEvents(int deadline_ms, size_t maxTasks);
+
+    /// Descriptor that becomes readable when the thread that called Init()
+    /// has tasks to dispatch, for epoll, libuv, asio and other event loops.
+    /// It is only read by DispatchEvents(), -1 on platforms without one.
+
+    static int EventFd();
+
+    enum InternalThread {
+      kNetworkThread,
+      kWorkerThread,
+    };
+
+    /// Stats of the threads peer connections run on. Everything they
+    /// dispatch counts as kNormal with queue delay in whole milliseconds.
+    /// Socket I/O of the network thread is not counted as busy.
+
+    static Worker::WorkerStats Stats(InternalThread thread);
+
     static void Dispose();
 };
 
@@ -842,7 +2279,12 @@ class CRTC_EXPORT AudioBuffer : virtual public ArrayBuffer {
    CRTC_PRIVATE(AudioBuffer);
 
   public:
-    static Let<AudioBuffer> New(int channels = 2, int sampleRate = 44100, int bitsPerSample = 8, int frames = 1);
+    static Let<AudioBuffer> New(int channels = 2, int sampleRate = 44100, int bitsPerSample = 8, int frames = 1, bool zeroFill = true);
+    /// Shares the memory of buffer, nothing is copied. Earlier versions took
+    /// a copy, now writing to buffer changes the samples of every AudioBuffer
+    /// made from it, so give each one a buffer of its own until it has been
+    /// written out.
+
     static Let<AudioBuffer> New(const Let<ArrayBuffer> &buffer, int channels = 2, int sampleRate = 44100, int bitsPerSample = 8, int frames = 1);
 
     virtual int Channels() const = 0;
@@ -893,11 +2335,54 @@ class CRTC_EXPORT ImageBuffer : public ArrayBuffer {
     CRTC_PRIVATE(ImageBuffer);
 
   public:
-    static Let<ImageBuffer> New(int width, int height);
+    /// Layout of the pixels. Planar formats have their planes in DataY(),
+    /// DataU() and DataV(). NV12 keeps interleaved chroma in DataU(), packed
+    /// formats keep every pixel in DataY(), missing planes are nullptr with
+    /// a stride of 0. I010 holds 10 bit samples in 16 bits. Strides are in
+    /// bytes. VideoSource converts images of any format to I420 only when
+    /// it forwards them, frames it drops are never converted and a failed
+    /// conversion is reported to the callback of Write().
+
+    enum PixelFormat {
+      kI420,
+      kNV12,
+      kI444,
+      kI010,
+      kRGBA,
+      kBGRA,
+    };
+
+    /// Memory comes from BufferPool, zeroFill as in BufferPool::New().
+
+    static Let<ImageBuffer> New(int width, int height, bool zeroFill = true);
+    static Let<ImageBuffer> New(int width, int height, PixelFormat format, bool zeroFill = true);
+
+    /// I420 image with every plane starting at a multiple of alignment bytes,
+    /// which has to be a power of two. Rows take strideY and strideUV bytes,
+    /// zero rounds the width of the plane up to alignment so rows stay
+    /// aligned as well. Such an image is handed to WebRTC as it is, padding
+    /// included.
+
+    static Let<ImageBuffer> NewAligned(int width, int height, int alignment, int strideY = 0, int strideUV = 0, bool zeroFill = true);
+
+    /// Shares the memory of buffer, nothing is copied. Buffer must hold an
+    /// I420 image of exactly width x height. Earlier versions took a copy,
+    /// now writing to buffer changes every image made from it, including
+    /// frames still queued in VideoSource::Write(). Reading each frame into
+    /// a buffer of its own from BufferPool::New() keeps them apart.
+
     static Let<ImageBuffer> New(const Let<ArrayBuffer> &buffer, int width, int height);
 
+    /// Same for an image of format with tightly packed planes, buffer must
+    /// hold exactly ByteLength(width, height, format) bytes.
+
+    static Let<ImageBuffer> New(const Let<ArrayBuffer> &buffer, int width, int height, PixelFormat format);
+
     static size_t ByteLength(int height, int stride_y, int stride_u, int stride_v);
     static size_t ByteLength(int width, int height);
+    static size_t ByteLength(int width, int height, PixelFormat format);
+
+    virtual PixelFormat Format() const = 0;
 
     virtual int Width() const = 0;
     virtual int Height() const = 0;
@@ -1029,6 +2514,8 @@ class CRTC_EXPORT RTCDataChannel : virtual public Reference {
 
     ErrorCallback onerror;
 
+    /// Buffer shares memory with WebRTC and its slices are read-only views
+    /// of it. Writing through Data() of the buffer copies it first.
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCDataChannel/onmessage
 
     MessageCallback onmessage;
@@ -1197,7 +2684,7 @@ class CRTC_EXPORT RTCPeerConnection : virtual public Reference {
 
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCPeerConnection/addIceCandidate
 
-    virtual Let<Promise<void>> AddIceCandidate(const RTCIceCandidate &candidate) = 0;
+    virtual Let<Promise<void>> AddIceCandidate(const RTCIceCandidate &candidate, const Let<AbortSignal> &signal = Let<AbortSignal>()) = 0;
 
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCPeerConnection/addStream
 
@@ -1205,11 +2692,11 @@ class CRTC_EXPORT RTCPeerConnection : virtual public Reference {
 
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCPeerConnection/createAnswer
 
-    virtual Let<Promise<RTCSessionDescription>> CreateAnswer(const RTCAnswerOptions &options = RTCAnswerOptions()) = 0;
+    virtual Let<Promise<RTCSessionDescription>> CreateAnswer(const RTCAnswerOptions &options = RTCAnswerOptions(), const Let<AbortSignal> &signal = Let<AbortSignal>()) = 0;
 
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCPeerConnection/createOffer
 
-    virtual Let<Promise<RTCSessionDescription>> CreateOffer(const RTCOfferOptions &options = RTCOfferOptions()) = 0;
+    virtual Let<Promise<RTCSessionDescription>> CreateOffer(const RTCOfferOptions &options = RTCOfferOptions(), const Let<AbortSignal> &signal = Let<AbortSignal>()) = 0;
 
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCPeerConnection/getLocalStreams
 
@@ -1229,11 +2716,11 @@ class CRTC_EXPORT RTCPeerConnection : virtual public Reference {
 
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCPeerConnection/setLocalDescription
 
-    virtual Let<Promise<void>> SetLocalDescription(const RTCSessionDescription &sdp) = 0;
+    virtual Let<Promise<void>> SetLocalDescription(const RTCSessionDescription &sdp, const Let<AbortSignal> &signal = Let<AbortSignal>()) = 0;
 
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCPeerConnection/setRemoteDescription
 
-    virtual Let<Promise<void>> SetRemoteDescription(const RTCSessionDescription &sdp) = 0;
+    virtual Let<Promise<void>> SetRemoteDescription(const RTCSessionDescription &sdp, const Let<AbortSignal> &signal = Let<AbortSignal>()) = 0;
 
     /// \sa https://developer.mozilla.org/en-US/docs/Web/API/RTCPeerConnection/close
 
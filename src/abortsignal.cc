@@ -0,0 +1,145 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "crtc.h"
+#include "abortsignal.h"
+
+using namespace crtc;
+
+AbortSignalInternal::AbortSignalInternal() : _aborted(false), _worker(Worker::This()), _next(0) {
+
+}
+
+AbortSignalInternal::~AbortSignalInternal() {
+
+}
+
+bool AbortSignalInternal::Aborted() const {
+  return _aborted.load(std::memory_order_acquire);
+}
+
+Let<Error> AbortSignalInternal::Reason() const {
+  rtc::CritScope cs(&_lock);
+  return _reason;
+}
+
+int AbortSignalInternal::AddListener(const ErrorCallback &callback) {
+  Let<Error> reason;
+
+  {
+    rtc::CritScope cs(&_lock);
+
+    if (!_aborted.load(std::memory_order_relaxed)) {
+      _listeners.push_back(std::make_pair(++_next, callback));
+      return _next;
+    }
+
+    reason = _reason;
+  }
+
+  callback(reason);
+  return 0;
+}
+
+void AbortSignalInternal::RemoveListener(int id) {
+  ErrorCallback callback;
+
+  {
+    rtc::CritScope cs(&_lock);
+
+    for (auto it = _listeners.begin(); it != _listeners.end(); ++it) {
+      if (it->first == id) {
+        callback = std::move(it->second);
+        _listeners.erase(it);
+        break;
+      }
+    }
+  }
+}
+
+void AbortSignalInternal::Abort(const Let<Error> &reason) {
+  std::vector<std::pair<int, ErrorCallback>> listeners;
+  Let<Error> error = reason.IsEmpty() ? Error::New("Aborted.", __FILE__, __LINE__) : reason;
+
+  {
+    rtc::CritScope cs(&_lock);
+
+    if (_aborted.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    _reason = error;
+    _aborted.store(true, std::memory_order_release);
+    listeners.swap(_listeners);
+  }
+
+  for (const auto &listener: listeners) {
+    listener.second(error);
+  }
+
+  if (!onabort.IsEmpty()) {
+    Let<AbortSignalInternal> self(this);
+
+    Async::Call(Callback([=]() {
+      self->onabort();
+    }), 0, _worker);
+  }
+}
+
+Let<AbortSignal> AbortSignal::Timeout(int delay) {
+  Let<AbortSignalInternal> signal = Let<AbortSignalInternal>::New();
+  WeakLet<AbortSignalInternal> weak(signal);
+
+  Async::Call(Callback([=]() {
+    Let<AbortSignalInternal> signal = weak.Lock();
+
+    if (!signal.IsEmpty()) {
+      signal->Abort(Error::New("Timeout.", __FILE__, __LINE__));
+    }
+  }), (delay > 0) ? delay : 0);
+
+  return signal;
+}
+
+AbortControllerInternal::AbortControllerInternal() : _signal(Let<AbortSignalInternal>::New()) {
+
+}
+
+AbortControllerInternal::~AbortControllerInternal() {
+
+}
+
+Let<AbortSignal> AbortControllerInternal::Signal() const {
+  return _signal;
+}
+
+void AbortControllerInternal::Abort(const Let<Error> &reason) {
+  _signal->Abort(reason);
+}
+
+Let<AbortController> AbortController::New() {
+  return Let<AbortControllerInternal>::New();
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#ifndef CRTC_ABORTSIGNAL_H
+#define CRTC_ABORTSIGNAL_H
+
+#include "crtc.h"
+#include "webrtc/base/criticalsection.h"
+
+namespace crtc {
+  class AbortSignalInternal : public AbortSignal {
+      friend class Let<AbortSignalInternal>;
+
+    public:
+      bool Aborted() const override;
+      Let<Error> Reason() const override;
+
+      int AddListener(const ErrorCallback &callback) override;
+      void RemoveListener(int id) override;
+
+      void Abort(const Let<Error> &reason);
+
+    protected:
+      explicit AbortSignalInternal();
+      ~AbortSignalInternal() override;
+
+      mutable rtc::CriticalSection _lock;
+      std::atomic<bool> _aborted;
+      Let<Error> _reason GUARDED_BY(_lock);
+      Let<Worker> _worker;
+      std::vector<std::pair<int, ErrorCallback>> _listeners GUARDED_BY(_lock);
+      int _next GUARDED_BY(_lock);
+  };
+
+  class AbortControllerInternal : public AbortController {
+      friend class Let<AbortControllerInternal>;
+
+    public:
+      Let<AbortSignal> Signal() const override;
+      void Abort(const Let<Error> &reason) override;
+
+    protected:
+      explicit AbortControllerInternal();
+      ~AbortControllerInternal() override;
+
+      Let<AbortSignalInternal> _signal;
+  };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,290 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "crtc.h"
+#include "allocator.h"
+
+#include <algorithm>
+
+using namespace crtc;
+
+Allocator::AllocCallback AllocatorInternal::alloc_callback = nullptr;
+Allocator::FreeCallback AllocatorInternal::free_callback = nullptr;
+thread_local bool AllocatorInternal::cache_disposed = false;
+
+void *Allocator::Alloc(size_t size) {
+  if (AllocatorInternal::alloc_callback) {
+    return AllocatorInternal::alloc_callback(size);
+  }
+
+  return AllocatorInternal::Alloc(size);
+}
+
+void Allocator::Free(void *ptr, size_t size) {
+  if (AllocatorInternal::free_callback) {
+    return AllocatorInternal::free_callback(ptr, size);
+  }
+
+  AllocatorInternal::Free(ptr, size);
+}
+
+void Allocator::SetCallbacks(AllocCallback alloc, FreeCallback free) {
+  AllocatorInternal::alloc_callback = (alloc && free) ? alloc : nullptr;
+  AllocatorInternal::free_callback = (alloc && free) ? free : nullptr;
+}
+
+std::vector<Allocator::PoolStats> Allocator::Stats() {
+  return AllocatorInternal::Stats();
+}
+
+AllocatorInternal::Cache::Cache() {
+  for (size_t index = 0; index < kClasses; index++) {
+    blocks[index] = nullptr;
+    count[index] = 0;
+    allocs[index] = 0;
+    frees[index] = 0;
+    hits[index] = 0;
+    misses[index] = 0;
+  }
+
+  Pool *pool = AllocatorInternal::GetPool();
+  rtc::CritScope cs(&pool->lock);
+  pool->caches.push_back(this);
+}
+
+AllocatorInternal::Cache::~Cache() {
+  Pool *pool = AllocatorInternal::GetPool();
+  AllocatorInternal::cache_disposed = true;
+
+  for (size_t index = 0; index < kClasses; index++) {
+    AllocatorInternal::Release(this, index, count[index]);
+  }
+
+  rtc::CritScope cs(&pool->lock);
+
+  for (size_t index = 0; index < kClasses; index++) {
+    pool->allocs[index] += allocs[index].load(std::memory_order_relaxed);
+    pool->frees[index] += frees[index].load(std::memory_order_relaxed);
+    pool->hits[index] += hits[index].load(std::memory_order_relaxed);
+    pool->misses[index] += misses[index].load(std::memory_order_relaxed);
+  }
+
+  pool->caches.erase(std::remove(pool->caches.begin(), pool->caches.end(), this), pool->caches.end());
+}
+
+AllocatorInternal::Pool::Pool() {
+  for (size_t index = 0; index < kClasses; index++) {
+    blocks[index] = nullptr;
+    resident[index] = 0;
+    allocs[index] = 0;
+    frees[index] = 0;
+    hits[index] = 0;
+    misses[index] = 0;
+  }
+}
+
+AllocatorInternal::Pool *AllocatorInternal::GetPool() {
+  // Never destroyed, objects may still be released while the process exits.
+  static Pool *pool = new Pool();
+  return pool;
+}
+
+AllocatorInternal::Cache *AllocatorInternal::GetCache() {
+  if (!AllocatorInternal::cache_disposed) {
+    static thread_local Cache cache;
+    return &cache;
+  }
+
+  return nullptr;
+}
+
+void AllocatorInternal::Refill(Cache *cache, size_t index) {
+  Pool *pool = AllocatorInternal::GetPool();
+  rtc::CritScope cs(&pool->lock);
+
+  while (pool->blocks[index] && cache->count[index] < kBatch) {
+    Block *block = pool->blocks[index];
+    pool->blocks[index] = block->next;
+    block->next = cache->blocks[index];
+    cache->blocks[index] = block;
+    cache->count[index]++;
+  }
+
+  if (!cache->blocks[index]) {
+    size_t size = (index + 1) * kAlignment;
+    uint8_t *slab = static_cast<uint8_t*>(::operator new(kSlabSize));
+
+    for (size_t offset = 0; offset + size <= kSlabSize; offset += size) {
+      Block *block = reinterpret_cast<Block*>(slab + offset);
+      block->next = cache->blocks[index];
+      cache->blocks[index] = block;
+      cache->count[index]++;
+    }
+
+    pool->resident[index] += kSlabSize;
+  }
+}
+
+void AllocatorInternal::Release(Cache *cache, size_t index, size_t count) {
+  if (!count) {
+    return;
+  }
+
+  Block *head = cache->blocks[index];
+  Block *tail = head;
+
+  for (size_t released = 1; released < count; released++) {
+    tail = tail->next;
+  }
+
+  cache->blocks[index] = tail->next;
+  cache->count[index] -= count;
+
+  Pool *pool = AllocatorInternal::GetPool();
+  rtc::CritScope cs(&pool->lock);
+
+  tail->next = pool->blocks[index];
+  pool->blocks[index] = head;
+}
+
+void *AllocatorInternal::Alloc(size_t size) {
+  if (!size || size > kMaxSize) {
+    return ::operator new(size);
+  }
+
+  size_t index = (size - 1) / kAlignment;
+  Cache *cache = AllocatorInternal::GetCache();
+
+  if (!cache) {
+    // Thread is exiting, blocks end up on the shared lists when freed and
+    // have to be as large as their class.
+
+    Pool *pool = AllocatorInternal::GetPool();
+    rtc::CritScope cs(&pool->lock);
+
+    pool->allocs[index]++;
+
+    if (!pool->blocks[index]) {
+      size_t block = (index + 1) * kAlignment;
+      uint8_t *slab = static_cast<uint8_t*>(::operator new(kSlabSize));
+
+      for (size_t offset = 0; offset + block <= kSlabSize; offset += block) {
+        Block *entry = reinterpret_cast<Block*>(slab + offset);
+        entry->next = pool->blocks[index];
+        pool->blocks[index] = entry;
+      }
+
+      pool->resident[index] += kSlabSize;
+      pool->misses[index]++;
+    } else {
+      pool->hits[index]++;
+    }
+
+    Block *block = pool->blocks[index];
+    pool->blocks[index] = block->next;
+
+    return block;
+  }
+
+  cache->allocs[index].store(cache->allocs[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+  if (cache->blocks[index]) {
+    cache->hits[index].store(cache->hits[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  } else {
+    cache->misses[index].store(cache->misses[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    AllocatorInternal::Refill(cache, index);
+  }
+
+  Block *block = cache->blocks[index];
+  cache->blocks[index] = block->next;
+  cache->count[index]--;
+
+  return block;
+}
+
+void AllocatorInternal::Free(void *ptr, size_t size) {
+  if (!ptr) {
+    return;
+  }
+
+  if (!size || size > kMaxSize) {
+    return ::operator delete(ptr);
+  }
+
+  size_t index = (size - 1) / kAlignment;
+  Block *block = static_cast<Block*>(ptr);
+  Cache *cache = AllocatorInternal::GetCache();
+
+  if (!cache) {
+    Pool *pool = AllocatorInternal::GetPool();
+    rtc::CritScope cs(&pool->lock);
+
+    pool->frees[index]++;
+    block->next = pool->blocks[index];
+    pool->blocks[index] = block;
+    return;
+  }
+
+  cache->frees[index].store(cache->frees[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+  block->next = cache->blocks[index];
+  cache->blocks[index] = block;
+  cache->count[index]++;
+
+  if (cache->count[index] > kCacheLimit) {
+    AllocatorInternal::Release(cache, index, kCacheLimit - kBatch);
+  }
+}
+
+std::vector<Allocator::PoolStats> AllocatorInternal::Stats() {
+  std::vector<Allocator::PoolStats> stats;
+  Pool *pool = AllocatorInternal::GetPool();
+  rtc::CritScope cs(&pool->lock);
+
+  for (size_t index = 0; index < kClasses; index++) {
+    Allocator::PoolStats entry;
+
+    entry.size = (index + 1) * kAlignment;
+    entry.allocs = pool->allocs[index];
+    entry.frees = pool->frees[index];
+    entry.hits = pool->hits[index];
+    entry.misses = pool->misses[index];
+    entry.resident = pool->resident[index];
+
+    for (const auto &cache : pool->caches) {
+      entry.allocs += cache->allocs[index].load(std::memory_order_relaxed);
+      entry.frees += cache->frees[index].load(std::memory_order_relaxed);
+      entry.hits += cache->hits[index].load(std::memory_order_relaxed);
+      entry.misses += cache->misses[index].load(std::memory_order_relaxed);
+    }
+
+    if (entry.allocs || entry.resident) {
+      stats.push_back(entry);
+    }
+  }
+
+  return stats;
+}
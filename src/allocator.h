@@ -0,0 +1,95 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#ifndef CRTC_ALLOCATOR_H
+#define CRTC_ALLOCATOR_H
+
+#include "crtc.h"
+#include "webrtc/base/criticalsection.h"
+
+namespace crtc {
+  class AllocatorInternal {
+    public:
+      enum {
+        kAlignment = 16,
+        kMaxSize = 512,
+        kClasses = kMaxSize / kAlignment,
+        kSlabSize = 64 * 1024,
+        kBatch = 32,
+        kCacheLimit = 4 * kBatch,
+      };
+
+      typedef struct Block {
+        struct Block *next;
+      } Block;
+
+      static void *Alloc(size_t size);
+      static void Free(void *ptr, size_t size);
+      static std::vector<Allocator::PoolStats> Stats();
+
+      static Allocator::AllocCallback alloc_callback;
+      static Allocator::FreeCallback free_callback;
+
+    protected:
+      class Cache {
+        public:
+          explicit Cache();
+          ~Cache();
+
+          Block *blocks[kClasses];
+          size_t count[kClasses];
+
+          std::atomic<uint64_t> allocs[kClasses];
+          std::atomic<uint64_t> frees[kClasses];
+          std::atomic<uint64_t> hits[kClasses];
+          std::atomic<uint64_t> misses[kClasses];
+      };
+
+      class Pool {
+        public:
+          explicit Pool();
+
+          rtc::CriticalSection lock;
+          std::vector<Cache*> caches GUARDED_BY(lock);
+
+          Block *blocks[kClasses] GUARDED_BY(lock);
+          size_t resident[kClasses] GUARDED_BY(lock);
+          uint64_t allocs[kClasses] GUARDED_BY(lock);
+          uint64_t frees[kClasses] GUARDED_BY(lock);
+          uint64_t hits[kClasses] GUARDED_BY(lock);
+          uint64_t misses[kClasses] GUARDED_BY(lock);
+      };
+
+      static Pool *GetPool();
+      static Cache *GetCache();
+      static void Refill(Cache *cache, size_t index);
+      static void Release(Cache *cache, size_t index, size_t count);
+
+      static thread_local bool cache_disposed;
+  };
+};
+
+#endif
@@ -42,6 +42,10 @@ Let<ArrayBuffer> ArrayBuffer::New(const uint8_t *data, size_t byteLength) {
   return Let<ArrayBufferInternal>::New(data, byteLength);
 }
 
+Let<ArrayBuffer> ArrayBuffer::Adopt(uint8_t *data, size_t byteLength, const Deleter &deleter) {
+  return Let<ArrayBufferInternal>::New(data, byteLength, deleter);
+}
+
 ArrayBufferInternal::ArrayBufferInternal(const uint8_t *data, size_t byteLength) : 
   _alloc(false),
   _data(nullptr),
@@ -50,19 +54,37 @@ ArrayBufferInternal::ArrayBufferInternal(const uint8_t *data, size_t byteLength)
   ArrayBufferInternal::Init(data, byteLength);
 }
 
+ArrayBufferInternal::ArrayBufferInternal(uint8_t *data, size_t byteLength, const Deleter &deleter) :
+  _alloc(false),
+  _data(data),
+  _byteLength(byteLength),
+  _deleter(deleter)
+{ }
+
 ArrayBufferInternal::ArrayBufferInternal(const Let<ArrayBuffer> &buffer) : 
   _alloc(false),
   _data(nullptr),
-  _byteLength(0)
+  _byteLength(0),
+  _parent(buffer)
 {
   if (!buffer.IsEmpty()) {
-    ArrayBufferInternal::Init(buffer->Data(), buffer->ByteLength());
+    _data = buffer->Data();
+    _byteLength = buffer->ByteLength();
   } 
 }
 
+ArrayBufferInternal::ArrayBufferInternal(const Let<ArrayBuffer> &parent, uint8_t *data, size_t byteLength) :
+  _alloc(false),
+  _data(data),
+  _byteLength(byteLength),
+  _parent(parent)
+{ }
+
 ArrayBufferInternal::~ArrayBufferInternal() {
   if (_alloc && _data) {
     delete [] _data;
+  } else if (_deleter) {
+    _deleter(_data, _byteLength);
   }
 }
 
@@ -85,6 +107,22 @@ size_t ArrayBufferInternal::ByteLength() const {
 }
 
 Let<ArrayBuffer> ArrayBufferInternal::Slice(size_t begin, size_t end) const {
+  if (begin <= end && end <= _byteLength) {
+    // Views of views point at the buffer that owns the memory.
+
+    Let<ArrayBuffer> parent = _parent;
+
+    if (parent.IsEmpty()) {
+      parent = const_cast<ArrayBufferInternal*>(this);
+    }
+
+    return Let<ArrayBufferInternal>::New(parent, _data + begin, ((!end) ? _byteLength : end - begin));
+  }
+
+  return Let<ArrayBuffer>();
+}
+
+Let<ArrayBuffer> ArrayBufferInternal::Copy(size_t begin, size_t end) const {
   if (begin <= end && end <= _byteLength) {
     return Let<ArrayBufferInternal>::New(_data + begin, ((!end) ? _byteLength : end - begin));
   }
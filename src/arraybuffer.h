@@ -38,6 +38,7 @@ namespace crtc {
       size_t ByteLength() const override;
 
       Let<ArrayBuffer> Slice(size_t begin = 0, size_t end = 0) const override;
+      Let<ArrayBuffer> Copy(size_t begin = 0, size_t end = 0) const override;
 
       uint8_t *Data() override;
       const uint8_t *Data() const override;
@@ -49,7 +50,12 @@ namespace crtc {
  
     protected:
       explicit ArrayBufferInternal(const uint8_t *data = nullptr, size_t byteLength = 0);
+      ArrayBufferInternal(uint8_t *data, size_t byteLength, const Deleter &deleter);
+
+      // Shares the memory of buffer and keeps buffer alive.
+
       ArrayBufferInternal(const Let<ArrayBuffer> &buffer);
+      ArrayBufferInternal(const Let<ArrayBuffer> &parent, uint8_t *data, size_t byteLength);
       
       ~ArrayBufferInternal() override;
 
@@ -57,6 +63,8 @@ namespace crtc {
 
       uint8_t* _data;
       size_t _byteLength;
+      Deleter _deleter;
+      Let<ArrayBuffer> _parent;
   };
 };
 
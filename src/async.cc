@@ -26,35 +26,202 @@
 #include "crtc.h"
 #include "async.h"
 #include "worker.h"
+#include "timer.h"
 
 #include "webrtc/base/thread.h"
 #include "webrtc/base/asyncinvoker.h"
+#include "webrtc/base/timeutils.h"
 
 using namespace crtc;
 
 std::unique_ptr<rtc::Thread> _worker;
 rtc::AsyncInvoker* _async;
+rtc::Thread* _module = nullptr;
 
 void AsyncInternal::Init() {
   _async = new rtc::AsyncInvoker();
+  _module = rtc::Thread::Current();
 }
 
 void AsyncInternal::Dispose() {
+  _module = nullptr;
   delete _async;
 }
 
-void Async::Call(Functor<void()> callback, int delay, Let<Worker> ptr) {
-  Let<Event> event = Event::New();
-  Let<WorkerInternal> worker(ptr);
-  rtc::Thread *target = (!worker.IsEmpty()) ? worker : rtc::Thread::Current();
+void Async::Call(Functor<void()> callback, int delay, Let<Worker> worker, Let<AbortSignal> signal) {
+  AsyncInternal::Call(std::move(callback), delay, Worker::kNormal, 0, std::move(worker), std::move(signal));
+}
+
+void Async::Call(Functor<void()> callback, Worker::Priority priority, int deadline, Let<Worker> worker, Let<AbortSignal> signal) {
+  AsyncInternal::Call(std::move(callback), 0, priority, deadline, std::move(worker), std::move(signal));
+}
+
+void AsyncInternal::Call(Callback &&callback, int delay, Worker::Priority priority, int deadline, Let<Worker> ptr, Let<AbortSignal> signal) {
+  Let<WorkerBase> worker(std::move(ptr));
+  Let<AsyncAbortable> abortable;
+  Let<Event> event;
+
+  if (!signal.IsEmpty() && signal->Aborted()) {
+    return;
+  }
+
+  if (!worker.IsEmpty() && delay > 0) {
+    TimerInternal::New(std::move(callback), delay, 0, worker->Target(), signal);
+    return;
+  }
+
+  if (!signal.IsEmpty()) {
+    abortable = AsyncAbortable::New(std::move(callback), signal);
+  } else {
+    event = Event::New();
+  }
+
+  if (!worker.IsEmpty()) {
+
+    // The task gets a reference of its own, ours keeps the worker alive
+    // until Post() returns even if the task has already run and gone.
+
+    AsyncTask *task = new AsyncTask(std::move(callback), Let<WorkerBase>(worker), std::move(event), std::move(abortable));
+
+    if (priority >= Worker::kRealtime && priority <= Worker::kBackground) {
+      task->priority = priority;
+    }
+
+    if (deadline > 0) {
+      task->deadline = rtc::TimeMicros() + static_cast<int64_t>(deadline) * rtc::kNumMicrosecsPerMillisec;
+    }
+
+    return worker->Post(task);
+  }
+
+  rtc::Thread *target = rtc::Thread::Current();
+  AsyncTask task(std::move(callback), std::move(worker), std::move(event), std::move(abortable));
 
   if (delay > 0) {
-    _async->AsyncInvokeDelayed<void>(RTC_FROM_HERE, target, [worker, callback, event]() mutable {
-      callback();
-    }, delay);
+    _async->AsyncInvokeDelayed<void>(RTC_FROM_HERE, target, std::move(task), delay);
   } else {
-    _async->AsyncInvoke<void>(RTC_FROM_HERE, target, [worker, callback, event]() mutable {
-      callback();
-    });
+    _async->AsyncInvoke<void>(RTC_FROM_HERE, target, std::move(task));
+  }
+}
+
+void Async::Queue(Functor<void()> callback, Let<Worker> ptr) {
+  Let<WorkerBase> worker(ptr);
+  rtc::Thread *target = (!worker.IsEmpty()) ? worker->Target() : rtc::Thread::Current();
+
+  if (target != rtc::Thread::Current()) {
+    return Async::Call(std::move(callback), 0, std::move(ptr));
+  }
+
+  AsyncInternal::Queue(std::move(callback));
+}
+
+void Async::Dispatch(Functor<void()> callback) {
+  rtc::Thread *target = _module;
+
+  if (!target || target == rtc::Thread::Current()) {
+    return AsyncInternal::Queue(std::move(callback));
+  }
+
+  AsyncTask task(std::move(callback), Let<WorkerBase>(), Event::New());
+  _async->AsyncInvoke<void>(RTC_FROM_HERE, target, std::move(task));
+}
+
+thread_local AsyncInternal::Microtasks AsyncInternal::microtasks;
+thread_local bool AsyncInternal::microtasks_disposed = false;
+
+AsyncInternal::Microtasks::~Microtasks() {
+  AsyncInternal::microtasks_disposed = true;
+}
+
+void AsyncInternal::Queue(Callback &&callback) {
+  if (AsyncInternal::microtasks_disposed) {
+    return callback();
+  }
+
+  Microtasks *microtasks = &AsyncInternal::microtasks;
+  microtasks->queue.push_back(std::move(callback));
+
+  // Outside of a task nobody is going to drain the queue, post an empty
+  // task to the current thread and let it run the queue when it finishes.
+
+  if (!microtasks->depth && !microtasks->scheduled) {
+    microtasks->scheduled = true;
+    Async::Call(Callback([]() { }), 0, Let<Worker>());
+  }
+}
+
+void AsyncInternal::Enter() {
+  AsyncInternal::microtasks.depth++;
+}
+
+void AsyncInternal::Leave() {
+  Microtasks *microtasks = &AsyncInternal::microtasks;
+
+  if (microtasks->depth == 1) {
+    AsyncInternal::Drain(microtasks);
+  }
+
+  microtasks->depth--;
+}
+
+void AsyncInternal::Drain(Microtasks *microtasks) {
+  microtasks->scheduled = false;
+
+  while (!microtasks->queue.empty()) {
+    Callback callback(std::move(microtasks->queue.front()));
+    microtasks->queue.pop_front();
+    callback();
+  }
+}
+
+AsyncAbortable::AsyncAbortable(Callback &&callback, const Let<AbortSignal> &signal) :
+  _aborted(false),
+  _callback(std::move(callback)),
+  _event(Event::New()),
+  _signal(signal),
+  _listener(0)
+{ }
+
+AsyncAbortable::~AsyncAbortable() {
+  _signal->RemoveListener(_listener);
+}
+
+Let<AsyncAbortable> AsyncAbortable::New(Callback &&callback, const Let<AbortSignal> &signal) {
+  Let<AsyncAbortable> abortable = Let<AsyncAbortable>::New(std::move(callback), signal);
+  WeakLet<AsyncAbortable> weak(abortable);
+
+  abortable->_listener = signal->AddListener([=](const Let<Error> &reason) {
+    Let<AsyncAbortable> abortable = weak.Lock();
+
+    if (!abortable.IsEmpty()) {
+      abortable->Abort();
+    }
+  });
+
+  return abortable;
+}
+
+void AsyncAbortable::Run() {
+  Callback callback;
+  Let<Event> event;
+
+  {
+    rtc::CritScope cs(&_lock);
+    callback = std::move(_callback);
+    event = std::move(_event);
+  }
+
+  callback();
+}
+
+void AsyncAbortable::Abort() {
+  Callback callback;
+  Let<Event> event;
+
+  {
+    rtc::CritScope cs(&_lock);
+    _aborted.store(true, std::memory_order_release);
+    callback = std::move(_callback);
+    event = std::move(_event);
   }
 }
\ No newline at end of file
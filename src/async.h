@@ -28,12 +28,126 @@
 #define CRTC_ASYNC_H
 
 #include "crtc.h"
+#include "worker.h"
+#include "webrtc/base/criticalsection.h"
+
+#include <deque>
 
 namespace crtc {
   class AsyncInternal {
     public:
       static void Init();
       static void Dispose();
+
+      static void Call(Callback &&callback, int delay, Worker::Priority priority, int deadline, Let<Worker> worker, Let<AbortSignal> signal);
+
+      static void Queue(Callback &&callback);
+      static void Enter();
+      static void Leave();
+
+    protected:
+      class Microtasks {
+        public:
+          explicit Microtasks() : depth(0), scheduled(false) { }
+          ~Microtasks();
+
+          std::deque<Callback> queue;
+          int depth;
+          bool scheduled;
+      };
+
+      static void Drain(Microtasks *microtasks);
+
+      static thread_local Microtasks microtasks;
+      static thread_local bool microtasks_disposed;
+  };
+
+  // Callback of an Async::Call made with a signal. Aborting releases the
+  // callback and its event right away, the queued task is then dropped
+  // without being run.
+
+  class AsyncAbortable : public Reference {
+      friend class Let<AsyncAbortable>;
+
+    public:
+      static Let<AsyncAbortable> New(Callback &&callback, const Let<AbortSignal> &signal);
+
+      void Run();
+      void Abort();
+
+      inline bool Aborted() const {
+        return _aborted.load(std::memory_order_acquire);
+      }
+
+    protected:
+      explicit AsyncAbortable(Callback &&callback, const Let<AbortSignal> &signal);
+      ~AsyncAbortable() override;
+
+      std::atomic<bool> _aborted;
+      rtc::CriticalSection _lock;
+      Callback _callback GUARDED_BY(_lock);
+      Let<Event> _event GUARDED_BY(_lock);
+      Let<AbortSignal> _signal;
+      int _listener;
+  };
+
+  // Task of an Async::Call, either moved into rtc::AsyncInvoker or pushed
+  // as is to the task queue of a worker.
+
+  class AsyncTask : public WorkerTask {
+    public:
+      explicit AsyncTask(Callback &&callback, Let<WorkerBase> &&worker, Let<Event> &&event, Let<AsyncAbortable> &&abortable = Let<AsyncAbortable>()) :
+        _callback(std::move(callback)),
+        _worker(std::move(worker)),
+        _event(std::move(event)),
+        _abortable(std::move(abortable))
+      { }
+
+      AsyncTask(AsyncTask &&task) :
+        WorkerTask(),
+        _callback(std::move(task._callback)),
+        _worker(std::move(task._worker)),
+        _event(std::move(task._event)),
+        _abortable(std::move(task._abortable))
+      { }
+
+      inline static void *operator new(size_t size) {
+        return Allocator::Alloc(size);
+      }
+
+      inline static void operator delete(void *ptr, size_t size) {
+        Allocator::Free(ptr, size);
+      }
+
+      inline void operator()() {
+        if (AsyncTask::Cancelled()) {
+          return;
+        }
+
+        AsyncInternal::Enter();
+
+        if (!_abortable.IsEmpty()) {
+          _abortable->Run();
+        } else {
+          _callback();
+        }
+
+        AsyncInternal::Leave();
+      }
+
+      void Run() override {
+        (*this)();
+      }
+
+      bool Cancelled() const override {
+        return !_abortable.IsEmpty() && _abortable->Aborted();
+      }
+
+    private:
+      Callback _callback;
+      Let<WorkerBase> _worker;
+      Let<Event> _event;
+      Let<AsyncAbortable> _abortable;
   };
 };
 
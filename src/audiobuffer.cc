@@ -49,6 +49,10 @@ Let<ArrayBuffer> AudioBufferInternal::Slice(size_t begin, size_t end) const {
   return ArrayBufferInternal::Slice(begin, end);
 }
 
+Let<ArrayBuffer> AudioBufferInternal::Copy(size_t begin, size_t end) const {
+  return ArrayBufferInternal::Copy(begin, end);
+}
+
 uint8_t *AudioBufferInternal::Data() {
   return ArrayBufferInternal::Data();
 }
@@ -77,8 +81,14 @@ int AudioBufferInternal::Frames() const {
   return _frames;
 }
 
-Let<AudioBuffer> AudioBuffer::New(int channels, int sampleRate, int bitsPerSample, int frames) {
-  return Let<AudioBufferInternal>::New(ArrayBuffer::New(sampleRate / 100), channels, sampleRate, bitsPerSample, frames);
+Let<AudioBuffer> AudioBuffer::New(int channels, int sampleRate, int bitsPerSample, int frames, bool zeroFill) {
+  Let<ArrayBuffer> buffer = BufferPool::New(sampleRate / 100, zeroFill);
+
+  if (!buffer.IsEmpty()) {
+    return Let<AudioBufferInternal>::New(buffer, channels, sampleRate, bitsPerSample, frames);
+  }
+
+  return Let<AudioBuffer>::Empty();
 }
 
 Let<AudioBuffer> AudioBuffer::New(const Let<ArrayBuffer> &buffer, int channels, int sampleRate, int bitsPerSample, int frames) {
@@ -38,6 +38,7 @@ namespace crtc {
       size_t ByteLength() const override;
 
       Let<ArrayBuffer> Slice(size_t begin = 0, size_t end = 0) const override;
+      Let<ArrayBuffer> Copy(size_t begin = 0, size_t end = 0) const override;
 
       uint8_t *Data() override;
       const uint8_t *Data() const override;
@@ -39,7 +39,7 @@ namespace crtc {
       AudioDevice() :
         _capturing(false),
         _drainNeeded(false),
-        _clock(RealTimeClock::New(Functor<void()>(this, &AudioDevice::OnTime)))
+        _clock(RealTimeClock::New(Functor<void()>(this, &AudioDevice::OnTime), RealTimeClock::kCatchUp))
       {
         
       }
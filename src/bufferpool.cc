@@ -0,0 +1,340 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "crtc.h"
+#include "bufferpool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace crtc;
+
+thread_local bool BufferPoolInternal::cache_disposed = false;
+
+Let<ArrayBuffer> BufferPool::New(size_t byteLength, bool zeroFill) {
+  if (!byteLength) {
+    return ArrayBuffer::New();
+  }
+
+  uint8_t *data = BufferPoolInternal::Alloc(byteLength, zeroFill);
+
+  if (data) {
+    return ArrayBuffer::Adopt(data, byteLength, &BufferPoolInternal::Free);
+  }
+
+  return Let<ArrayBuffer>::Empty();
+}
+
+void BufferPool::SetLimit(size_t byteLength) {
+  BufferPoolInternal::SetLimit(byteLength);
+}
+
+std::vector<BufferPool::PoolStats> BufferPool::Stats() {
+  return BufferPoolInternal::Stats();
+}
+
+BufferPoolInternal::Cache::Cache() : size(0) {
+  for (size_t index = 0; index < kClasses; index++) {
+    blocks[index] = nullptr;
+    count[index] = 0;
+    allocs[index] = 0;
+    frees[index] = 0;
+    hits[index] = 0;
+    misses[index] = 0;
+  }
+
+  Pool *pool = BufferPoolInternal::GetPool();
+  rtc::CritScope cs(&pool->lock);
+  pool->caches.push_back(this);
+}
+
+BufferPoolInternal::Cache::~Cache() {
+  Pool *pool = BufferPoolInternal::GetPool();
+  BufferPoolInternal::cache_disposed = true;
+
+  for (size_t index = 0; index < kClasses; index++) {
+    while (blocks[index]) {
+      Block *block = blocks[index];
+      blocks[index] = block->next;
+
+      if (!BufferPoolInternal::Give(block, index)) {
+        std::free(block);
+      }
+    }
+
+    count[index] = 0;
+  }
+
+  size = 0;
+
+  rtc::CritScope cs(&pool->lock);
+
+  for (size_t index = 0; index < kClasses; index++) {
+    pool->allocs[index] += allocs[index].load(std::memory_order_relaxed);
+    pool->frees[index] += frees[index].load(std::memory_order_relaxed);
+    pool->hits[index] += hits[index].load(std::memory_order_relaxed);
+    pool->misses[index] += misses[index].load(std::memory_order_relaxed);
+  }
+
+  pool->caches.erase(std::remove(pool->caches.begin(), pool->caches.end(), this), pool->caches.end());
+}
+
+BufferPoolInternal::Pool::Pool() : idle(0), limit(kDefaultLimit) {
+  for (size_t index = 0; index < kClasses; index++) {
+    blocks[index] = nullptr;
+    resident[index] = 0;
+    allocs[index] = 0;
+    frees[index] = 0;
+    hits[index] = 0;
+    misses[index] = 0;
+  }
+}
+
+BufferPoolInternal::Pool *BufferPoolInternal::GetPool() {
+  // Never destroyed, buffers may still be released while the process exits.
+  static Pool *pool = new Pool();
+  return pool;
+}
+
+BufferPoolInternal::Cache *BufferPoolInternal::GetCache() {
+  if (!BufferPoolInternal::cache_disposed) {
+    static thread_local Cache cache;
+    return &cache;
+  }
+
+  return nullptr;
+}
+
+size_t BufferPoolInternal::Index(size_t byteLength) {
+  if (byteLength <= (static_cast<size_t>(1) << kMinShift)) {
+    return 0;
+  }
+
+  if (byteLength > (static_cast<size_t>(1) << kMaxShift)) {
+    return kClasses;
+  }
+
+  // byteLength is in (2^shift, 2^(shift + 1)], split into kSteps classes.
+
+  size_t shift = kMinShift;
+
+  while ((static_cast<size_t>(1) << (shift + 1)) < byteLength) {
+    shift++;
+  }
+
+  size_t step = ((byteLength - 1) - (static_cast<size_t>(1) << shift)) >> (shift - 2);
+  return 1 + (shift - kMinShift) * kSteps + step;
+}
+
+size_t BufferPoolInternal::Size(size_t index) {
+  if (!index) {
+    return static_cast<size_t>(1) << kMinShift;
+  }
+
+  size_t shift = kMinShift + (index - 1) / kSteps;
+  size_t step = (index - 1) % kSteps;
+
+  return (static_cast<size_t>(1) << shift) + (step + 1) * (static_cast<size_t>(1) << (shift - 2));
+}
+
+BufferPoolInternal::Block *BufferPoolInternal::Take(size_t index) {
+  Pool *pool = BufferPoolInternal::GetPool();
+  rtc::CritScope cs(&pool->lock);
+  Block *block = pool->blocks[index];
+
+  if (block) {
+    pool->blocks[index] = block->next;
+    pool->idle -= BufferPoolInternal::Size(index);
+  } else {
+    pool->resident[index] += BufferPoolInternal::Size(index);
+  }
+
+  return block;
+}
+
+bool BufferPoolInternal::Give(Block *block, size_t index) {
+  Pool *pool = BufferPoolInternal::GetPool();
+  size_t size = BufferPoolInternal::Size(index);
+  rtc::CritScope cs(&pool->lock);
+
+  if (pool->idle + size <= pool->limit) {
+    block->next = pool->blocks[index];
+    pool->blocks[index] = block;
+    pool->idle += size;
+    return true;
+  }
+
+  pool->resident[index] -= size;
+  return false;
+}
+
+void BufferPoolInternal::Trim(Pool *pool, std::vector<Block*> *blocks) {
+  // Largest buffers go first, they give back the most for the least work.
+
+  for (size_t index = kClasses; index > 0 && pool->idle > pool->limit; index--) {
+    size_t size = BufferPoolInternal::Size(index - 1);
+
+    while (pool->blocks[index - 1] && pool->idle > pool->limit) {
+      Block *block = pool->blocks[index - 1];
+      pool->blocks[index - 1] = block->next;
+      pool->idle -= size;
+      pool->resident[index - 1] -= size;
+      blocks->push_back(block);
+    }
+  }
+}
+
+uint8_t *BufferPoolInternal::Alloc(size_t byteLength, bool zeroFill) {
+  size_t index = BufferPoolInternal::Index(byteLength);
+
+  if (index >= kClasses) {
+    return static_cast<uint8_t*>(zeroFill ? std::calloc(byteLength, 1) : std::malloc(byteLength));
+  }
+
+  size_t size = BufferPoolInternal::Size(index);
+  Cache *cache = BufferPoolInternal::GetCache();
+  Block *block = nullptr;
+
+  if (cache && cache->blocks[index]) {
+    block = cache->blocks[index];
+    cache->blocks[index] = block->next;
+    cache->count[index]--;
+    cache->size -= size;
+  } else {
+    block = BufferPoolInternal::Take(index);
+  }
+
+  if (cache) {
+    BufferPoolInternal::Count(cache->allocs[index]);
+    BufferPoolInternal::Count(block ? cache->hits[index] : cache->misses[index]);
+  } else {
+    Pool *pool = BufferPoolInternal::GetPool();
+    rtc::CritScope cs(&pool->lock);
+
+    pool->allocs[index]++;
+    (block ? pool->hits[index] : pool->misses[index])++;
+  }
+
+  if (!block) {
+    uint8_t *data = static_cast<uint8_t*>(zeroFill ? std::calloc(size, 1) : std::malloc(size));
+
+    if (!data) {
+      Pool *pool = BufferPoolInternal::GetPool();
+      rtc::CritScope cs(&pool->lock);
+      pool->resident[index] -= size;
+    }
+
+    return data;
+  }
+
+  if (zeroFill) {
+    std::memset(block, 0, byteLength);
+  }
+
+  return reinterpret_cast<uint8_t*>(block);
+}
+
+void BufferPoolInternal::Free(uint8_t *data, size_t byteLength) {
+  if (!data) {
+    return;
+  }
+
+  size_t index = BufferPoolInternal::Index(byteLength);
+
+  if (index >= kClasses) {
+    return std::free(data);
+  }
+
+  size_t size = BufferPoolInternal::Size(index);
+  Block *block = reinterpret_cast<Block*>(data);
+  Cache *cache = BufferPoolInternal::GetCache();
+
+  if (cache) {
+    BufferPoolInternal::Count(cache->frees[index]);
+
+    if (cache->count[index] < kCacheLimit && cache->size + size <= kCacheSize) {
+      block->next = cache->blocks[index];
+      cache->blocks[index] = block;
+      cache->count[index]++;
+      cache->size += size;
+      return;
+    }
+  } else {
+    Pool *pool = BufferPoolInternal::GetPool();
+    rtc::CritScope cs(&pool->lock);
+    pool->frees[index]++;
+  }
+
+  if (!BufferPoolInternal::Give(block, index)) {
+    std::free(block);
+  }
+}
+
+void BufferPoolInternal::SetLimit(size_t byteLength) {
+  Pool *pool = BufferPoolInternal::GetPool();
+  std::vector<Block*> blocks;
+
+  {
+    rtc::CritScope cs(&pool->lock);
+    pool->limit = byteLength;
+    BufferPoolInternal::Trim(pool, &blocks);
+  }
+
+  for (Block *block : blocks) {
+    std::free(block);
+  }
+}
+
+std::vector<BufferPool::PoolStats> BufferPoolInternal::Stats() {
+  std::vector<BufferPool::PoolStats> stats;
+  Pool *pool = BufferPoolInternal::GetPool();
+  rtc::CritScope cs(&pool->lock);
+
+  for (size_t index = 0; index < kClasses; index++) {
+    BufferPool::PoolStats entry;
+
+    entry.size = BufferPoolInternal::Size(index);
+    entry.allocs = pool->allocs[index];
+    entry.frees = pool->frees[index];
+    entry.hits = pool->hits[index];
+    entry.misses = pool->misses[index];
+    entry.resident = pool->resident[index];
+
+    for (const auto &cache : pool->caches) {
+      entry.allocs += cache->allocs[index].load(std::memory_order_relaxed);
+      entry.frees += cache->frees[index].load(std::memory_order_relaxed);
+      entry.hits += cache->hits[index].load(std::memory_order_relaxed);
+      entry.misses += cache->misses[index].load(std::memory_order_relaxed);
+    }
+
+    if (entry.allocs || entry.resident) {
+      stats.push_back(entry);
+    }
+  }
+
+  return stats;
+}
@@ -0,0 +1,112 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#ifndef CRTC_BUFFERPOOL_H
+#define CRTC_BUFFERPOOL_H
+
+#include "crtc.h"
+#include "webrtc/base/criticalsection.h"
+
+namespace crtc {
+  class BufferPoolInternal {
+    public:
+      enum {
+        kMinShift = 10,
+        kMaxShift = 26,
+        kSteps = 4,
+        kClasses = (kMaxShift - kMinShift) * kSteps + 1,
+        kCacheLimit = 4,
+        kCacheSize = 16 * 1024 * 1024,
+        kDefaultLimit = 64 * 1024 * 1024,
+      };
+
+      typedef struct Block {
+        struct Block *next;
+      } Block;
+
+      static uint8_t *Alloc(size_t byteLength, bool zeroFill);
+      static void Free(uint8_t *data, size_t byteLength);
+      static void SetLimit(size_t byteLength);
+      static std::vector<BufferPool::PoolStats> Stats();
+
+      // Class of byteLength, kClasses when it is too large to be pooled.
+      static size_t Index(size_t byteLength);
+      static size_t Size(size_t index);
+
+    protected:
+      class Cache {
+        public:
+          explicit Cache();
+          ~Cache();
+
+          Block *blocks[kClasses];
+          size_t count[kClasses];
+          size_t size;
+
+          std::atomic<uint64_t> allocs[kClasses];
+          std::atomic<uint64_t> frees[kClasses];
+          std::atomic<uint64_t> hits[kClasses];
+          std::atomic<uint64_t> misses[kClasses];
+      };
+
+      class Pool {
+        public:
+          explicit Pool();
+
+          rtc::CriticalSection lock;
+          std::vector<Cache*> caches GUARDED_BY(lock);
+
+          Block *blocks[kClasses] GUARDED_BY(lock);
+          size_t idle GUARDED_BY(lock);
+          size_t limit GUARDED_BY(lock);
+          size_t resident[kClasses] GUARDED_BY(lock);
+          uint64_t allocs[kClasses] GUARDED_BY(lock);
+          uint64_t frees[kClasses] GUARDED_BY(lock);
+          uint64_t hits[kClasses] GUARDED_BY(lock);
+          uint64_t misses[kClasses] GUARDED_BY(lock);
+      };
+
+      static Pool *GetPool();
+      static Cache *GetCache();
+
+      // Takes an idle buffer from the shared pool or accounts for a new one,
+      // which the caller allocates outside of the lock.
+      static Block *Take(size_t index);
+
+      // Gives a buffer to the shared pool, returns false when it is over its
+      // limit and the caller has to free the buffer.
+      static bool Give(Block *block, size_t index);
+      static void Trim(Pool *pool, std::vector<Block*> *blocks);
+
+      static inline void Count(std::atomic<uint64_t> &counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      }
+
+      static thread_local bool cache_disposed;
+  };
+};
+
+#endif
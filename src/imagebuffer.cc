@@ -26,38 +26,190 @@
 #include "crtc.h"
 #include "imagebuffer.h"
 
+#include "libyuv/convert.h"
+
+#include <algorithm>
+
 using namespace crtc;
 
-ImageBufferInternal::ImageBufferInternal(const Let<ArrayBuffer> &buffer, int width, int height) : 
-  ArrayBufferInternal(buffer),
-  _width(width), 
-  _height(height)
-{
-  _y = ArrayBufferInternal::Data();
-  _u = ArrayBufferInternal::Data() + _width * _height;
-  _v = ArrayBufferInternal::Data() + _width * _height + ((_width + 1) >> 1) * ((_height + 1) >> 1);
+ImageBufferInternal::ImageBufferInternal(const Let<ArrayBuffer> &buffer, uint8_t *data, int width, int height, PixelFormat format, const Layout &layout) :
+  ArrayBufferInternal(buffer, data, layout.byteLength),
+  _width(width),
+  _height(height),
+  _format(format),
+  _strideY(layout.stride[0]),
+  _strideU(layout.stride[1]),
+  _strideV(layout.stride[2]),
+  _y(data),
+  _u((layout.planes > 1) ? data + layout.offset[1] : nullptr),
+  _v((layout.planes > 2) ? data + layout.offset[2] : nullptr)
+{ }
+
+ImageBufferInternal::~ImageBufferInternal() {
+  
 }
 
-ImageBufferInternal::ImageBufferInternal(int width, int height) :
-  ArrayBufferInternal(nullptr, ImageBuffer::ByteLength(width, height)),
-  _width(width), 
-  _height(height) 
-{
-  _y = ArrayBufferInternal::Data();
-  _u = ArrayBufferInternal::Data() + _width * _height;
-  _v = ArrayBufferInternal::Data() + _width * _height + ((_width + 1) >> 1) * ((_height + 1) >> 1);
+bool ImageBufferInternal::Plan(int width, int height, PixelFormat format, int alignment, int strideY, int strideUV, Layout *layout) {
+  if (width < 0 || height < 0 || alignment <= 0 || (alignment & (alignment - 1))) {
+    return false;
+  }
+
+  size_t mask = static_cast<size_t>(alignment) - 1;
+  int chromaWidth = (width + 1) >> 1;
+  int rowY = width;
+  int rowUV = chromaWidth;
+  int rows = (height + 1) >> 1;
+
+  layout->planes = 3;
+
+  switch (format) {
+    case kI420:
+      break;
+    case kNV12:
+      rowUV = chromaWidth * 2;
+      layout->planes = 2;
+      break;
+    case kI444:
+      rowUV = width;
+      rows = height;
+      break;
+    case kI010:
+      rowY = width * 2;
+      rowUV = chromaWidth * 2;
+      break;
+    case kRGBA:
+    case kBGRA:
+      rowY = width * 4;
+      rowUV = 0;
+      rows = 0;
+      layout->planes = 1;
+      break;
+    default:
+      return false;
+  }
+
+  strideY = (strideY) ? strideY : static_cast<int>((static_cast<size_t>(rowY) + mask) & ~mask);
+  strideUV = (layout->planes == 1) ? 0 : (strideUV) ? strideUV : static_cast<int>((static_cast<size_t>(rowUV) + mask) & ~mask);
+
+  if (strideY < rowY || strideUV < rowUV) {
+    return false;
+  }
+
+  size_t end = static_cast<size_t>(strideY) * height;
+
+  layout->stride[0] = strideY;
+  layout->offset[0] = 0;
+
+  for (int plane = 1; plane < 3; plane++) {
+    if (plane < layout->planes) {
+      layout->stride[plane] = strideUV;
+      layout->offset[plane] = (end + mask) & ~mask;
+      end = layout->offset[plane] + static_cast<size_t>(strideUV) * rows;
+    } else {
+      layout->stride[plane] = 0;
+      layout->offset[plane] = 0;
+    }
+  }
+
+  layout->byteLength = end;
+  return true;
 }
 
-ImageBufferInternal::~ImageBufferInternal() {
-  
+Let<ImageBuffer> ImageBufferInternal::New(const Let<ArrayBuffer> &buffer, int width, int height, PixelFormat format) {
+  Layout layout;
+
+  if (!buffer.IsEmpty() && ImageBufferInternal::Plan(width, height, format, 1, 0, 0, &layout) && layout.byteLength == buffer->ByteLength()) {
+    return Let<ImageBufferInternal>::New(buffer, buffer->Data(), width, height, format, layout);
+  }
+
+  return Let<ImageBuffer>::Empty();
 }
 
-Let<ImageBuffer> ImageBufferInternal::New(const Let<ArrayBuffer> &buffer, int width, int height) {
-  return Let<ImageBufferInternal>::New(buffer, width, height);
+Let<ImageBuffer> ImageBufferInternal::New(int width, int height, PixelFormat format, int alignment, int strideY, int strideUV, bool zeroFill) {
+  Layout layout;
+
+  if (!ImageBufferInternal::Plan(width, height, format, alignment, strideY, strideUV, &layout)) {
+    return Let<ImageBuffer>::Empty();
+  }
+
+  // Pooled memory is only as aligned as malloc(), the image starts at the
+  // first aligned byte of a buffer that is large enough for any offset.
+
+  size_t mask = static_cast<size_t>(alignment) - 1;
+  Let<ArrayBuffer> buffer = BufferPool::New(layout.byteLength + ((layout.byteLength) ? mask : 0), zeroFill);
+
+  if (!buffer.IsEmpty()) {
+    uint8_t *data = buffer->Data() + ((alignment - (reinterpret_cast<uintptr_t>(buffer->Data()) & mask)) & mask);
+    return Let<ImageBufferInternal>::New(buffer, data, width, height, format, layout);
+  }
+
+  return Let<ImageBuffer>::Empty();
 }
 
-Let<ImageBuffer> ImageBufferInternal::New(int width, int height) {
-  return Let<ImageBufferInternal>::New(width, height);
+Let<ImageBuffer> ImageBufferInternal::ToI420(const Let<ImageBuffer> &source) {
+  if (source.IsEmpty() || source->Format() == kI420) {
+    return source;
+  }
+
+  int width = source->Width();
+  int height = source->Height();
+  Let<ImageBuffer> image = ImageBufferInternal::New(width, height, kI420, kAlignment, 0, 0, false);
+
+  if (image.IsEmpty()) {
+    return image;
+  }
+
+  uint8_t *y = const_cast<uint8_t*>(image->DataY());
+  uint8_t *u = const_cast<uint8_t*>(image->DataU());
+  uint8_t *v = const_cast<uint8_t*>(image->DataV());
+  int result = -1;
+
+  switch (source->Format()) {
+    case kNV12:
+      result = libyuv::NV12ToI420(source->DataY(), source->StrideY(), source->DataU(), source->StrideU(),
+                                  y, image->StrideY(), u, image->StrideU(), v, image->StrideV(), width, height);
+      break;
+    case kI444:
+      result = libyuv::I444ToI420(source->DataY(), source->StrideY(), source->DataU(), source->StrideU(), source->DataV(), source->StrideV(),
+                                  y, image->StrideY(), u, image->StrideU(), v, image->StrideV(), width, height);
+      break;
+    case kI010:
+      ImageBufferInternal::Narrow(source->DataY(), source->StrideY(), y, image->StrideY(), width, height);
+      ImageBufferInternal::Narrow(source->DataU(), source->StrideU(), u, image->StrideU(), (width + 1) >> 1, (height + 1) >> 1);
+      ImageBufferInternal::Narrow(source->DataV(), source->StrideV(), v, image->StrideV(), (width + 1) >> 1, (height + 1) >> 1);
+      result = 0;
+      break;
+    case kRGBA:
+      // libyuv names packed formats by their 32 bit word, RGBA in memory is ABGR.
+      result = libyuv::ABGRToI420(source->DataY(), source->StrideY(), y, image->StrideY(), u, image->StrideU(), v, image->StrideV(), width, height);
+      break;
+    case kBGRA:
+      result = libyuv::ARGBToI420(source->DataY(), source->StrideY(), y, image->StrideY(), u, image->StrideU(), v, image->StrideV(), width, height);
+      break;
+    default:
+      break;
+  }
+
+  if (result) {
+    return Let<ImageBuffer>::Empty();
+  }
+
+  return image;
+}
+
+void ImageBufferInternal::Narrow(const uint8_t *source, int sourceStride, uint8_t *target, int targetStride, int width, int height) {
+  for (int row = 0; row < height; row++) {
+    const uint16_t *samples = reinterpret_cast<const uint16_t*>(source + static_cast<size_t>(sourceStride) * row);
+    uint8_t *pixels = target + static_cast<size_t>(targetStride) * row;
+
+    for (int column = 0; column < width; column++) {
+      pixels[column] = static_cast<uint8_t>(std::min<uint16_t>(samples[column], 1023) >> 2);
+    }
+  }
+}
+
+ImageBuffer::PixelFormat ImageBufferInternal::Format() const {
+  return _format;
 }
 
 int ImageBufferInternal::Width() const {
@@ -81,15 +233,15 @@ const uint8_t* ImageBufferInternal::DataV() const {
 }
 
 int ImageBufferInternal::StrideY() const {
-  return _width;
+  return _strideY;
 }
 
 int ImageBufferInternal::StrideU() const {
-  return (_width + 1) >> 1;
+  return _strideU;
 }
 
 int ImageBufferInternal::StrideV() const {
-  return (_width + 1) >> 1;
+  return _strideV;
 }
 
 size_t ImageBufferInternal::ByteLength() const {
@@ -100,6 +252,10 @@ Let<ArrayBuffer> ImageBufferInternal::Slice(size_t begin, size_t end) const {
   return ArrayBufferInternal::Slice(begin, end);
 }
 
+Let<ArrayBuffer> ImageBufferInternal::Copy(size_t begin, size_t end) const {
+  return ArrayBufferInternal::Copy(begin, end);
+}
+
 uint8_t *ImageBufferInternal::Data() {
   return ArrayBufferInternal::Data();
 }
@@ -112,16 +268,24 @@ std::string ImageBufferInternal::ToString() const {
   return ArrayBufferInternal::ToString();
 }
 
-Let<ImageBuffer> ImageBuffer::New(int width, int height) {
-  return ImageBufferInternal::New(width, height);
+Let<ImageBuffer> ImageBuffer::New(int width, int height, bool zeroFill) {
+  return ImageBufferInternal::New(width, height, kI420, 1, 0, 0, zeroFill);
+}
+
+Let<ImageBuffer> ImageBuffer::New(int width, int height, PixelFormat format, bool zeroFill) {
+  return ImageBufferInternal::New(width, height, format, 1, 0, 0, zeroFill);
+}
+
+Let<ImageBuffer> ImageBuffer::NewAligned(int width, int height, int alignment, int strideY, int strideUV, bool zeroFill) {
+  return ImageBufferInternal::New(width, height, kI420, alignment, strideY, strideUV, zeroFill);
 }
 
 Let<ImageBuffer> ImageBuffer::New(const Let<ArrayBuffer> &buffer, int width, int height) {
-  if (ImageBuffer::ByteLength(width, height) == buffer->ByteLength()) {
-    return ImageBufferInternal::New(buffer, width, height);
-  }
-  
-  return Let<ImageBuffer>::Empty();
+  return ImageBufferInternal::New(buffer, width, height, kI420);
+}
+
+Let<ImageBuffer> ImageBuffer::New(const Let<ArrayBuffer> &buffer, int width, int height, PixelFormat format) {
+  return ImageBufferInternal::New(buffer, width, height, format);
 }
 
 size_t ImageBuffer::ByteLength(int height, int stride_y, int stride_u, int stride_v) {
@@ -136,6 +300,16 @@ size_t ImageBuffer::ByteLength(int width, int height) {
   return 0; 
 }
 
+size_t ImageBuffer::ByteLength(int width, int height, PixelFormat format) {
+  ImageBufferInternal::Layout layout;
+
+  if (ImageBufferInternal::Plan(width, height, format, 1, 0, 0, &layout)) {
+    return layout.byteLength;
+  }
+
+  return 0;
+}
+
 rtc::scoped_refptr<webrtc::VideoFrameBuffer> WrapImageBuffer::New(const Let<ImageBuffer> &source) {
   if (!source.IsEmpty()) {
     return new rtc::RefCountedObject<WrapImageBuffer>(source);
@@ -145,9 +319,25 @@ rtc::scoped_refptr<webrtc::VideoFrameBuffer> WrapImageBuffer::New(const Let<Imag
 }
 
 WrapImageBuffer::WrapImageBuffer(const Let<ImageBuffer> &source) :
-  _source(source)
+  _source(source),
+  _converted(false)
 { }
 
+const Let<ImageBuffer> &WrapImageBuffer::I420() const {
+  if (_source->Format() == ImageBuffer::kI420) {
+    return _source;
+  }
+
+  rtc::CritScope cs(&_lock);
+
+  if (!_converted) {
+    _converted = true;
+    _i420 = ImageBufferInternal::ToI420(_source);
+  }
+
+  return _i420;
+}
+
 WrapImageBuffer::~WrapImageBuffer() {
 
 }
@@ -161,27 +351,33 @@ int WrapImageBuffer::height() const {
 }
 
 const uint8_t* WrapImageBuffer::DataY() const {
-  return _source->DataY();
+  const Let<ImageBuffer> &image = WrapImageBuffer::I420();
+  return (!image.IsEmpty()) ? image->DataY() : nullptr;
 }
 
 const uint8_t* WrapImageBuffer::DataU() const {
-  return _source->DataU();
+  const Let<ImageBuffer> &image = WrapImageBuffer::I420();
+  return (!image.IsEmpty()) ? image->DataU() : nullptr;
 }
 
 const uint8_t* WrapImageBuffer::DataV() const {
-  return _source->DataV();
+  const Let<ImageBuffer> &image = WrapImageBuffer::I420();
+  return (!image.IsEmpty()) ? image->DataV() : nullptr;
 }
 
 int WrapImageBuffer::StrideY() const {
-  return _source->StrideY();
+  const Let<ImageBuffer> &image = WrapImageBuffer::I420();
+  return (!image.IsEmpty()) ? image->StrideY() : 0;
 }
 
 int WrapImageBuffer::StrideU() const {
-  return _source->StrideU();
+  const Let<ImageBuffer> &image = WrapImageBuffer::I420();
+  return (!image.IsEmpty()) ? image->StrideU() : 0;
 }
 
 int WrapImageBuffer::StrideV() const {
-  return _source->StrideV();
+  const Let<ImageBuffer> &image = WrapImageBuffer::I420();
+  return (!image.IsEmpty()) ? image->StrideV() : 0;
 }
 
 void* WrapImageBuffer::native_handle() const {
@@ -208,6 +404,10 @@ WrapVideoFrameBuffer::~WrapVideoFrameBuffer() {
 
 }
 
+ImageBuffer::PixelFormat WrapVideoFrameBuffer::Format() const {
+  return ImageBuffer::kI420;
+}
+
 int WrapVideoFrameBuffer::Width() const {
   return _vfb->width();
 }
@@ -245,10 +445,21 @@ size_t WrapVideoFrameBuffer::ByteLength() const {
 }
 
 Let<ArrayBuffer> WrapVideoFrameBuffer::Slice(size_t begin, size_t end) const {
-  Let<ArrayBuffer> buffer = ArrayBuffer::New(Data(), ByteLength());
+  size_t byteLength = ByteLength();
 
-  if (!buffer.IsEmpty()) {
-    return buffer->Slice(begin, end);
+  if (begin <= end && end <= byteLength) {
+    return Let<ArrayBufferInternal>::New(Let<ArrayBuffer>(const_cast<WrapVideoFrameBuffer*>(this)),
+                                         const_cast<uint8_t*>(Data()) + begin, ((!end) ? byteLength : end - begin));
+  }
+
+  return Let<ArrayBuffer>::Empty();
+}
+
+Let<ArrayBuffer> WrapVideoFrameBuffer::Copy(size_t begin, size_t end) const {
+  size_t byteLength = ByteLength();
+
+  if (begin <= end && end <= byteLength) {
+    return ArrayBuffer::New(Data() + begin, ((!end) ? byteLength : end - begin));
   }
 
   return Let<ArrayBuffer>::Empty();
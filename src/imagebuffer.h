@@ -29,6 +29,7 @@
 #include "crtc.h"
 #include "arraybuffer.h"
 
+#include "webrtc/base/criticalsection.h"
 #include "webrtc/base/refcount.h"
 #include "webrtc/common_video/include/video_frame_buffer.h"
 
@@ -37,8 +38,30 @@ namespace crtc {
       friend class Let<ImageBufferInternal>;
 
     public:
-      static Let<ImageBuffer> New(const Let<ArrayBuffer> &buffer, int width, int height);
-      static Let<ImageBuffer> New(int width = 0, int height = 0);
+      enum {
+        kAlignment = 64,
+      };
+
+      // Planes of an image and where they start, each at a multiple of
+      // alignment. Zero strides are the row rounded up to alignment.
+
+      typedef struct {
+        int planes;
+        int stride[3];
+        size_t offset[3];
+        size_t byteLength;
+      } Layout;
+
+      static bool Plan(int width, int height, PixelFormat format, int alignment, int strideY, int strideUV, Layout *layout);
+
+      static Let<ImageBuffer> New(const Let<ArrayBuffer> &buffer, int width, int height, PixelFormat format = kI420);
+      static Let<ImageBuffer> New(int width, int height, PixelFormat format, int alignment, int strideY, int strideUV, bool zeroFill);
+
+      // Source as I420 in aligned pooled memory, source itself when it
+      // already is I420.
+      static Let<ImageBuffer> ToI420(const Let<ImageBuffer> &source);
+
+      PixelFormat Format() const override;
 
       int Width() const override;
       int Height() const override;
@@ -54,6 +77,7 @@ namespace crtc {
       size_t ByteLength() const override;
 
       Let<ArrayBuffer> Slice(size_t begin = 0, size_t end = 0) const override;
+      Let<ArrayBuffer> Copy(size_t begin = 0, size_t end = 0) const override;
 
       uint8_t *Data() override;
       const uint8_t *Data() const override;
@@ -61,12 +85,21 @@ namespace crtc {
       std::string ToString() const override;
 
     protected:
-      explicit ImageBufferInternal(const Let<ArrayBuffer> &buffer, int width, int height);
-      ImageBufferInternal(int width = 0, int height = 0);
+      // Planes of layout at data, which lies inside buffer.
+
+      explicit ImageBufferInternal(const Let<ArrayBuffer> &buffer, uint8_t *data, int width, int height, PixelFormat format, const Layout &layout);
       ~ImageBufferInternal() override;
 
+      // 10 bit samples of a 16 bit plane down to 8 bits. libyuv in WebRTC
+      // has no 16 bit kernels yet.
+      static void Narrow(const uint8_t *source, int sourceStride, uint8_t *target, int targetStride, int width, int height);
+
       int _width;
       int _height;
+      PixelFormat _format;
+      int _strideY;
+      int _strideU;
+      int _strideV;
       
       const uint8_t* _y;
       const uint8_t* _u;
@@ -95,7 +128,16 @@ namespace crtc {
       explicit WrapImageBuffer(const Let<ImageBuffer> &source);
       ~WrapImageBuffer() override;
 
+      // Converts the source on first use, frames that are dropped before
+      // anyone reads their pixels are never converted. A failed conversion
+      // is not retried, planes stay nullptr.
+      const Let<ImageBuffer> &I420() const;
+
       Let<ImageBuffer> _source;
+
+      mutable rtc::CriticalSection _lock;
+      mutable Let<ImageBuffer> _i420 GUARDED_BY(_lock);
+      mutable bool _converted GUARDED_BY(_lock);
   };
 
   class WrapVideoFrameBuffer : public ImageBuffer {
@@ -104,6 +146,8 @@ namespace crtc {
     public:
       static Let<ImageBuffer> New(const rtc::scoped_refptr<webrtc::VideoFrameBuffer> &vfb);
 
+      PixelFormat Format() const override;
+
       int Width() const override;
       int Height() const override;
 
@@ -118,6 +162,7 @@ namespace crtc {
       size_t ByteLength() const override;
 
       Let<ArrayBuffer> Slice(size_t begin = 0, size_t end = 0) const override;
+      Let<ArrayBuffer> Copy(size_t begin = 0, size_t end = 0) const override;
 
       uint8_t *Data() override;
       const uint8_t *Data() const override;
@@ -25,28 +25,27 @@
 
 #include "crtc.h"
 #include "mediadevices.h"
+#include "module.h"
 #include <string> 
 
 using namespace crtc;
 
-std::unique_ptr<rtc::Thread> MediaDevicesInternal::network_thread;
-std::unique_ptr<rtc::Thread> MediaDevicesInternal::worker_thread;
+std::unique_ptr<MonitoredThread> MediaDevicesInternal::network_thread;
+std::unique_ptr<MonitoredThread> MediaDevicesInternal::worker_thread;
 rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> MediaDevicesInternal::media_factory;
 rtc::scoped_refptr<webrtc::AudioDeviceModule> MediaDevicesInternal::audio_device;
 std::unique_ptr<webrtc::VideoCaptureModule::DeviceInfo> MediaDevicesInternal::video_device;
 
 void MediaDevicesInternal::Init() {
-  network_thread = rtc::Thread::CreateWithSocketServer();
-  network_thread->SetName("network", nullptr);
+  network_thread = MonitoredThread::CreateWithSocketServer();
   
-  if (!network_thread->Start()) {
+  if (!network_thread->Launch(ModuleInternal::options.network, "network")) {
     
   }
 
-  worker_thread = rtc::Thread::Create();
-  worker_thread->SetName("worker", nullptr);
+  worker_thread = MonitoredThread::Create();
   
-  if (!worker_thread->Start()) {
+  if (!worker_thread->Launch(ModuleInternal::options.worker, "worker")) {
     
   }
 
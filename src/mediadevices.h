@@ -28,6 +28,7 @@
 #define CRTC_MEDIADEVICES_H
 
 #include "crtc.h"
+#include "worker.h"
 #include "mediastream.h"
 #include "mediastreamtrack.h"
 
@@ -193,8 +194,8 @@ class MediaDevicesInternal {
   public:
     static void Init();
 
-    static std::unique_ptr<rtc::Thread> network_thread;
-    static std::unique_ptr<rtc::Thread> worker_thread;
+    static std::unique_ptr<MonitoredThread> network_thread;
+    static std::unique_ptr<MonitoredThread> worker_thread;
     static rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> media_factory;
     static rtc::scoped_refptr<webrtc::AudioDeviceModule> audio_device;
     static std::unique_ptr<webrtc::VideoCaptureModule::DeviceInfo> video_device;
@@ -111,6 +111,7 @@ MediaStreamTracks MediaStreamInternal::GetAudioTracks() const {
   MediaStreamTracks tracks;
 
   auto audio_tracks(_stream->GetAudioTracks());
+  tracks.reserve(audio_tracks.size());
 
   for (const auto& track : audio_tracks) {
     tracks.push_back(MediaStreamTrackInternal::New(track));
@@ -123,6 +124,7 @@ MediaStreamTracks MediaStreamInternal::GetVideoTracks() const {
   MediaStreamTracks tracks;
 
   auto video_tracks(_stream->GetVideoTracks());
+  tracks.reserve(video_tracks.size());
 
   for (const auto& track : video_tracks) {
     tracks.push_back(MediaStreamTrackInternal::New(track));
@@ -30,6 +30,7 @@
 #include "videosource.h"
 
 #include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
 #include "webrtc/base/ssladapter.h"
 #include "webrtc/base/event_tracer.h"
 #include "webrtc/system_wrappers/include/trace.h"
@@ -41,11 +42,106 @@
   #include "webrtc/base/win32socketserver.h"
 #endif
 
+#ifdef CRTC_OS_LINUX
+  #include <poll.h>
+  #include <unistd.h>
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+  #include <sys/timerfd.h>
+#endif
+
 using namespace crtc;
 
 volatile int ModuleInternal::pending_events = 0;
+Module::ModuleOptions ModuleInternal::options;
+
+#ifdef CRTC_OS_LINUX
+EventLoop *ModuleInternal::loop = nullptr;
+
+EventLoop::EventLoop() :
+  _epoll(epoll_create1(EPOLL_CLOEXEC)),
+  _wakeup(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+  _timer(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK))
+{
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+
+  event.data.fd = _wakeup;
+  epoll_ctl(_epoll, EPOLL_CTL_ADD, _wakeup, &event);
+
+  event.data.fd = _timer;
+  epoll_ctl(_epoll, EPOLL_CTL_ADD, _timer, &event);
+}
+
+EventLoop::~EventLoop() {
+  close(_timer);
+  close(_wakeup);
+  close(_epoll);
+}
+
+// Called by the message queue while it waits for messages, the timerfd is
+// left alone as the queue knows its own delays.
+
+bool EventLoop::Wait(int cms, bool process_io) {
+  struct pollfd fds = { _wakeup, POLLIN, 0 };
+
+  if (poll(&fds, 1, cms) > 0) {
+    uint64_t value;
+
+    if (read(_wakeup, &value, sizeof(value)) < 0) {
+      // EAGAIN, another wakeup was already consumed.
+    }
+  }
+
+  return true;
+}
+
+void EventLoop::WakeUp() {
+  uint64_t value = 1;
+
+  if (write(_wakeup, &value, sizeof(value)) < 0) {
+    // EAGAIN, counter is saturated and the descriptor is readable anyway.
+  }
+}
+
+void EventLoop::Clear() {
+  uint64_t value;
+
+  if (read(_wakeup, &value, sizeof(value)) < 0) {
+    // EAGAIN, nothing to consume.
+  }
+
+  if (read(_timer, &value, sizeof(value)) < 0) {
+    // EAGAIN, timer has not expired.
+  }
+}
+
+// Makes the descriptor readable again after cms milliseconds, right away
+// when cms is zero and never when it is negative.
+
+void EventLoop::Arm(int cms) {
+  struct itimerspec spec = {};
+
+  if (!cms) {
+    return EventLoop::WakeUp();
+  }
+
+  if (cms > 0) {
+    spec.it_value.tv_sec = cms / 1000;
+    spec.it_value.tv_nsec = (cms % 1000) * 1000000;
+  }
+
+  timerfd_settime(_timer, 0, &spec, nullptr);
+}
+#endif
 
 void Module::Init() {
+  Module::Init(ModuleOptions());
+}
+
+void Module::Init(const ModuleOptions &options) {
+  ModuleInternal::options = options;
+
 #ifdef CRTC_OS_OSX
   rtc::InitCocoaMultiThreading();
 #endif
@@ -55,6 +151,11 @@ void Module::Init() {
 #endif
 
   rtc::ThreadManager::Instance()->WrapCurrentThread();
+
+#ifdef CRTC_OS_LINUX
+  ModuleInternal::loop = new EventLoop();
+  rtc::Thread::Current()->set_socketserver(ModuleInternal::loop);
+#endif
   //webrtc::Trace::CreateTrace();
   //rtc::LogMessage::LogToDebug(rtc::LS_ERROR);
 
@@ -68,6 +169,12 @@ void Module::Dispose() {
   RTCPeerConnectionInternal::Dispose();
   AsyncInternal::Dispose();
   rtc::CleanupSSL();
+
+#ifdef CRTC_OS_LINUX
+  rtc::Thread::Current()->set_socketserver(nullptr);
+  delete ModuleInternal::loop;
+  ModuleInternal::loop = nullptr;
+#endif
 }
 
 bool Module::DispatchEvents(bool kForever) {
@@ -77,5 +184,58 @@ bool Module::DispatchEvents(bool kForever) {
     result = (rtc::AtomicOps::AcquireLoad(&ModuleInternal::pending_events) > 0 && rtc::Thread::Current()->ProcessMessages(kForever ? 1000 : 0));
   } while (kForever && result);
 
+#ifdef CRTC_OS_LINUX
+  ModuleInternal::loop->Arm(rtc::Thread::Current()->GetDelay());
+#endif
+
   return result;
 }
+
+size_t Module::DispatchEvents(int deadline_ms, size_t maxTasks) {
+  rtc::Thread *thread = rtc::Thread::Current();
+  int64_t deadline = (deadline_ms > 0) ? rtc::TimeMillis() + deadline_ms : 0;
+  size_t count = 0;
+  rtc::Message msg;
+
+#ifdef CRTC_OS_LINUX
+  ModuleInternal::loop->Clear();
+#endif
+
+  // The deadline is checked before taking a task, a task that has been
+  // taken always runs.
+
+  while (count < maxTasks && (!deadline || rtc::TimeMillis() < deadline) && thread->Get(&msg, 0)) {
+    thread->Dispatch(&msg);
+    count++;
+  }
+
+  // Whatever is left makes the descriptor readable again, now or when the
+  // next delayed message is due.
+
+#ifdef CRTC_OS_LINUX
+  ModuleInternal::loop->Arm(thread->GetDelay());
+#endif
+
+  return count;
+}
+
+Worker::WorkerStats Module::Stats(InternalThread thread) {
+  MonitoredThread *target = (thread == kNetworkThread) ?
+    RTCPeerConnectionInternal::network_thread.get() :
+    RTCPeerConnectionInternal::worker_thread.get();
+
+  if (!target) {
+    Worker::WorkerStats stats = {};
+    return stats;
+  }
+
+  return target->Stats();
+}
+
+int Module::EventFd() {
+#ifdef CRTC_OS_LINUX
+  return ModuleInternal::loop ? ModuleInternal::loop->Fd() : -1;
+#else
+  return -1;
+#endif
+}
@@ -29,10 +29,47 @@
 
 #include "crtc.h"
 
+#ifdef CRTC_OS_LINUX
+#include "webrtc/base/nullsocketserver.h"
+#endif
+
 namespace crtc {
+#ifdef CRTC_OS_LINUX
+  // Socket server of the thread that called Module::Init(). Posting to the
+  // thread makes the epoll descriptor readable, so that a host event loop
+  // can wait on it next to its own descriptors. Delayed messages arm a
+  // timerfd that is part of the same set.
+
+  class EventLoop : public rtc::NullSocketServer {
+    public:
+      explicit EventLoop();
+      ~EventLoop() override;
+
+      bool Wait(int cms, bool process_io) override;
+      void WakeUp() override;
+
+      void Clear();
+      void Arm(int cms);
+
+      inline int Fd() const {
+        return _epoll;
+      }
+
+    protected:
+      int _epoll;
+      int _wakeup;
+      int _timer;
+  };
+#endif
+
   class ModuleInternal {
     public:
       static volatile int pending_events;
+      static Module::ModuleOptions options;
+
+#ifdef CRTC_OS_LINUX
+      static EventLoop *loop;
+#endif
   };
 };
 
@@ -162,6 +162,22 @@ size_t WrapRtcBuffer::ByteLength() const {
 }
 
 Let<ArrayBuffer> WrapRtcBuffer::Slice(size_t begin, size_t end) const {
+  if (begin <= end && end <= _data.size()) {
+    // Const data() never detaches the message from WebRTC. The view owns a
+    // handle of its own on the memory, so a later write through Data()
+    // detaches this buffer alone and the view keeps the memory it was made
+    // over. Writing through the view is not supported.
+
+    Let<ArrayBuffer> owner = Let<WrapRtcBuffer>::New(_data);
+    uint8_t *data = const_cast<uint8_t*>(_data.data());
+
+    return Let<ArrayBufferInternal>::New(owner, data + begin, ((!end) ? _data.size() : end - begin));
+  }
+
+  return Let<ArrayBuffer>();
+}
+
+Let<ArrayBuffer> WrapRtcBuffer::Copy(size_t begin, size_t end) const {
   if (begin <= end && end <= _data.size()) {
     return Let<ArrayBufferInternal>::New(_data.data() + begin, ((!end) ? _data.size() : end - begin));
   }
@@ -25,13 +25,14 @@
 
 #include "crtc.h"
 #include "rtcpeerconnection.h"
+#include "module.h"
 #include "rtcdatachannel.h"
 #include "mediastream.h"
 
 using namespace crtc;
 
-std::unique_ptr<rtc::Thread> RTCPeerConnectionInternal::network_thread;
-std::unique_ptr<rtc::Thread> RTCPeerConnectionInternal::worker_thread;
+std::unique_ptr<MonitoredThread> RTCPeerConnectionInternal::network_thread;
+std::unique_ptr<MonitoredThread> RTCPeerConnectionInternal::worker_thread;
 rtc::scoped_refptr<webrtc::AudioDeviceModule> RTCPeerConnectionInternal::audio_device;
 rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> RTCPeerConnectionInternal::factory;
 
@@ -44,17 +45,15 @@ RTCPeerConnection::RTCIceServers RTCPeerConnection::defaultIceServers = {
 };
 
 void RTCPeerConnectionInternal::Init() {
-  network_thread = rtc::Thread::CreateWithSocketServer();
-  network_thread->SetName("network", nullptr);
+  network_thread = MonitoredThread::CreateWithSocketServer();
   
-  if (!network_thread->Start()) {
+  if (!network_thread->Launch(ModuleInternal::options.network, "network")) {
     
   }
 
-  worker_thread = rtc::Thread::Create();
-  worker_thread->SetName("worker", nullptr);
+  worker_thread = MonitoredThread::Create();
   
-  if (!worker_thread->Start()) {
+  if (!worker_thread->Launch(ModuleInternal::options.worker, "worker")) {
     
   }
 
@@ -118,7 +117,7 @@ Let<RTCDataChannel> RTCPeerConnectionInternal::CreateDataChannel(const std::stri
   return Let<RTCDataChannel>();
 }
 
-Let<Promise<void> > RTCPeerConnectionInternal::AddIceCandidate(const RTCPeerConnection::RTCIceCandidate &candidate) {
+Let<Promise<void> > RTCPeerConnectionInternal::AddIceCandidate(const RTCPeerConnection::RTCIceCandidate &candidate, const Let<AbortSignal> &signal) {
   return Promise<void>::New([=](const Promise<void>::FullFilledCallback &resolve, const Promise<void>::RejectedCallback &reject) {
     webrtc::SdpParseError error;
     webrtc::IceCandidateInterface *ice = webrtc::CreateIceCandidate(candidate.sdpMid, candidate.sdpMLineIndex, candidate.candidate, &error);    
@@ -156,7 +155,7 @@ Let<Promise<void> > RTCPeerConnectionInternal::AddIceCandidate(const RTCPeerConn
     }
 
     return reject(Error::New(error.description, __FILE__, __LINE__));
-  });
+  }, Worker::This(), signal);
 }
 
 void RTCPeerConnectionInternal::AddStream(const Let<MediaStream> &stream) {
@@ -170,7 +169,7 @@ Let<RTCPeerConnection::RTCRtpSender> RTCPeerConnectionInternal::AddTrack(const L
 }
 */
 
-Let<Promise<RTCPeerConnection::RTCSessionDescription>> RTCPeerConnectionInternal::CreateAnswer(const RTCPeerConnection::RTCAnswerOptions &options) {
+Let<Promise<RTCPeerConnection::RTCSessionDescription>> RTCPeerConnectionInternal::CreateAnswer(const RTCPeerConnection::RTCAnswerOptions &options, const Let<AbortSignal> &signal) {
   Let<RTCPeerConnection> self(this);
 
   return Promise<RTCPeerConnection::RTCSessionDescription>::New([=](
@@ -191,10 +190,10 @@ Let<Promise<RTCPeerConnection::RTCSessionDescription>> RTCPeerConnectionInternal
     } else {
       reject(Error::New("CreateOfferAnswerObserver Failed", __FILE__, __LINE__));
     }
-  });
+  }, Worker::This(), signal);
 }
 
-Let<Promise<RTCPeerConnection::RTCSessionDescription>> RTCPeerConnectionInternal::CreateOffer(const RTCPeerConnection::RTCOfferOptions &options) {
+Let<Promise<RTCPeerConnection::RTCSessionDescription>> RTCPeerConnectionInternal::CreateOffer(const RTCPeerConnection::RTCOfferOptions &options, const Let<AbortSignal> &signal) {
   Let<RTCPeerConnection> self(this);
 
   return Promise<RTCPeerConnection::RTCSessionDescription>::New([=](
@@ -215,7 +214,7 @@ Let<Promise<RTCPeerConnection::RTCSessionDescription>> RTCPeerConnectionInternal
     } else {
       reject(Error::New("CreateOfferAnswerObserver Failed", __FILE__, __LINE__));
     }
-  });
+  }, Worker::This(), signal);
 }
 
 /*
@@ -235,12 +234,13 @@ Let<Promise<RTCPeerConnection::RTCCertificate>> RTCPeerConnectionInternal::Gener
 MediaStreams RTCPeerConnectionInternal::GetLocalStreams() {
   MediaStreams streams;
   rtc::scoped_refptr<webrtc::StreamCollectionInterface> lstreams(_socket->local_streams());
+  streams.reserve(lstreams->count());
 
   for (size_t index = 0; index < lstreams->count(); index++) {
     Let<MediaStream> stream = MediaStreamInternal::New(lstreams->at(index));
 
     if (!stream.IsEmpty()) {
-      streams.push_back(stream);
+      streams.push_back(std::move(stream));
     }
   }
 
@@ -250,12 +250,13 @@ MediaStreams RTCPeerConnectionInternal::GetLocalStreams() {
 MediaStreams RTCPeerConnectionInternal::GetRemoteStreams() {
   MediaStreams streams;
   rtc::scoped_refptr<webrtc::StreamCollectionInterface> rstreams(_socket->remote_streams());
+  streams.reserve(rstreams->count());
 
   for (size_t index = 0; index < rstreams->count(); index++) {
     Let<MediaStream> stream = MediaStreamInternal::New(rstreams->at(index));
 
     if (!stream.IsEmpty()) {
-      streams.push_back(stream);
+      streams.push_back(std::move(stream));
     }
   }
 
@@ -282,7 +283,7 @@ void RTCPeerConnectionInternal::SetConfiguration(const RTCPeerConnection::RTCCon
   }
 }
 
-Let<Promise<void> > RTCPeerConnectionInternal::SetLocalDescription(const RTCPeerConnection::RTCSessionDescription &sdp) {
+Let<Promise<void> > RTCPeerConnectionInternal::SetLocalDescription(const RTCPeerConnection::RTCSessionDescription &sdp, const Let<AbortSignal> &signal) {
   Let<RTCPeerConnection> self(this);
 
   return Promise<void>::New([=](
@@ -298,10 +299,10 @@ Let<Promise<void> > RTCPeerConnectionInternal::SetLocalDescription(const RTCPeer
     } else {
       reject(error);
     }
-  });
+  }, Worker::This(), signal);
 }
 
-Let<Promise<void> > RTCPeerConnectionInternal::SetRemoteDescription(const RTCPeerConnection::RTCSessionDescription &sdp) {
+Let<Promise<void> > RTCPeerConnectionInternal::SetRemoteDescription(const RTCPeerConnection::RTCSessionDescription &sdp, const Let<AbortSignal> &signal) {
   Let<RTCPeerConnection> self(this);
 
   return Promise<void>::New([=](
@@ -332,7 +333,7 @@ Let<Promise<void> > RTCPeerConnectionInternal::SetRemoteDescription(const RTCPee
     } else {
       reject(error);
     }
-  });
+  }, Worker::This(), signal);
 }
 
 void RTCPeerConnectionInternal::Close() {
@@ -28,6 +28,7 @@
 #define CRTC_RTCPEERCONNECTION_H
 
 #include "crtc.h"
+#include "worker.h"
 
 #include "webrtc/api/peerconnectioninterface.h"
 #include "webrtc/media/engine/webrtcvideodecoderfactory.h"
@@ -45,25 +46,25 @@ namespace crtc {
       static void Init();
       static void Dispose();
       
-      static std::unique_ptr<rtc::Thread> network_thread;
-      static std::unique_ptr<rtc::Thread> worker_thread;
+      static std::unique_ptr<MonitoredThread> network_thread;
+      static std::unique_ptr<MonitoredThread> worker_thread;
       static rtc::scoped_refptr<webrtc::AudioDeviceModule> audio_device;
       static rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory;
 
       Let<RTCDataChannel> CreateDataChannel(const std::string &label, const RTCDataChannelInit &options = RTCDataChannelInit()) override;
-      Let<Promise<void>> AddIceCandidate(const RTCPeerConnection::RTCIceCandidate &candidate) override;
+      Let<Promise<void>> AddIceCandidate(const RTCPeerConnection::RTCIceCandidate &candidate, const Let<AbortSignal> &signal) override;
       void AddStream(const Let<MediaStream> &stream) override;
       // Let<RTCPeerConnection::RTCRtpSender> AddTrack(const Let<MediaStreamTrack> &track, const Let<MediaStream> &stream) override;
-      Let<Promise<RTCPeerConnection::RTCSessionDescription>> CreateAnswer(const RTCPeerConnection::RTCAnswerOptions &options) override;
-      Let<Promise<RTCPeerConnection::RTCSessionDescription>> CreateOffer(const RTCPeerConnection::RTCOfferOptions &options) override;
+      Let<Promise<RTCPeerConnection::RTCSessionDescription>> CreateAnswer(const RTCPeerConnection::RTCAnswerOptions &options, const Let<AbortSignal> &signal) override;
+      Let<Promise<RTCPeerConnection::RTCSessionDescription>> CreateOffer(const RTCPeerConnection::RTCOfferOptions &options, const Let<AbortSignal> &signal) override;
       // Let<Promise<RTCPeerConnection::RTCCertificate>> GenerateCertificate() override;
       MediaStreams GetLocalStreams() override;
       MediaStreams GetRemoteStreams() override;
       void RemoveStream(const Let<MediaStream> &stream) override;
       // void RemoveTrack(const Let<RTCPeerConnection::RTCRtpSender> &sender) override;
       void SetConfiguration(const RTCPeerConnection::RTCConfiguration &config) override;
-      Let<Promise<void>> SetLocalDescription(const RTCPeerConnection::RTCSessionDescription &sdp) override;
-      Let<Promise<void>> SetRemoteDescription(const RTCPeerConnection::RTCSessionDescription &sdp) override;
+      Let<Promise<void>> SetLocalDescription(const RTCPeerConnection::RTCSessionDescription &sdp, const Let<AbortSignal> &signal) override;
+      Let<Promise<void>> SetRemoteDescription(const RTCPeerConnection::RTCSessionDescription &sdp, const Let<AbortSignal> &signal) override;
       void Close() override;
 
       RTCPeerConnection::RTCSessionDescription CurrentLocalDescription() override;
@@ -0,0 +1,129 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#ifndef CRTC_TASKQUEUE_H
+#define CRTC_TASKQUEUE_H
+
+#include <atomic>
+
+namespace crtc {
+
+  // Intrusive multi producer, single consumer queue (Dmitry Vyukov's design).
+  // Push() is wait-free and may be called from any thread, Pop() only from
+  // the consuming thread, as does Empty(). Pop() can briefly return nullptr
+  // while a producer is between its two steps, Empty() reports such a queue
+  // as not empty. Size() may be called from any thread and is approximate.
+
+  class TaskQueue {
+    public:
+      class Node {
+          friend class TaskQueue;
+
+        public:
+          explicit Node() : _next(nullptr) { }
+          virtual ~Node() { }
+
+          virtual void Run() { }
+
+        private:
+          std::atomic<Node*> _next;
+      };
+
+      explicit TaskQueue() : _head(&_stub), _pushed(0), _tail(&_stub), _popped(0) { }
+
+      inline void Push(Node *node) {
+        TaskQueue::Link(node);
+
+        // Same cache line as _head, which the producer owns at this point.
+        _pushed.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      inline Node *Pop() {
+        Node *tail = _tail;
+        Node *next = tail->_next.load(std::memory_order_acquire);
+
+        if (tail == &_stub) {
+          if (!next) {
+            return nullptr;
+          }
+
+          _tail = next;
+          tail = next;
+          next = next->_next.load(std::memory_order_acquire);
+        }
+
+        if (next) {
+          _tail = next;
+          return TaskQueue::Popped(tail);
+        }
+
+        if (tail != _head.load(std::memory_order_acquire)) {
+          return nullptr;
+        }
+
+        TaskQueue::Link(&_stub);
+        next = tail->_next.load(std::memory_order_acquire);
+
+        if (next) {
+          _tail = next;
+          return TaskQueue::Popped(tail);
+        }
+
+        return nullptr;
+      }
+
+      inline bool Empty() const {
+        return (_tail == &_stub && _head.load(std::memory_order_seq_cst) == &_stub);
+      }
+
+      inline size_t Size() const {
+        size_t popped = _popped.load(std::memory_order_relaxed);
+        size_t pushed = _pushed.load(std::memory_order_relaxed);
+
+        return (pushed > popped) ? pushed - popped : 0;
+      }
+
+    private:
+      inline void Link(Node *node) {
+        node->_next.store(nullptr, std::memory_order_relaxed);
+        Node *prev = _head.exchange(node, std::memory_order_seq_cst);
+        prev->_next.store(node, std::memory_order_release);
+      }
+
+      inline Node *Popped(Node *node) {
+        _popped.store(_popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return node;
+      }
+
+      std::atomic<Node*> _head;
+      std::atomic<size_t> _pushed;
+      Node *_tail;
+      std::atomic<size_t> _popped;
+      Node _stub;
+  };
+};
+
+#endif
\ No newline at end of file
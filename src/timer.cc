@@ -0,0 +1,329 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "crtc.h"
+#include "timer.h"
+#include "worker.h"
+#include "async.h"
+
+#include "webrtc/base/timeutils.h"
+
+using namespace crtc;
+
+TimerWheel::TimerWheel(int64_t now) : _now(now), _count(0) {
+  for (Link &link : _root) {
+    link.prev = link.next = &link;
+  }
+
+  for (auto &level : _levels) {
+    for (Link &link : level) {
+      link.prev = link.next = &link;
+    }
+  }
+}
+
+void TimerWheel::Splice(Link *from, Link *to) {
+  to->prev = to->next = to;
+
+  if (from->next != from) {
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    from->prev = from->next = from;
+  }
+}
+
+void TimerWheel::Unlink(Link *link) {
+  link->prev->next = link->next;
+  link->next->prev = link->prev;
+  link->prev = link->next = nullptr;
+}
+
+void TimerWheel::Insert(Node *node, int64_t expires) {
+
+  // Slot of the current tick may be running already, the earliest a new
+  // timer can expire is the next tick.
+
+  node->_expires = (expires > _now) ? expires : _now + 1;
+  TimerWheel::Place(node);
+}
+
+void TimerWheel::Place(Node *node) {
+  int64_t expires = node->_expires;
+  int64_t delta = expires - _now;
+  Link *head;
+
+  if (delta < kRootSize) {
+    head = &_root[expires & (kRootSize - 1)];
+  } else {
+    int level = 0;
+
+    if (delta > kMaxDelta) {
+      expires = _now + kMaxDelta;
+    }
+
+    while (level < kLevels - 1 && delta >= (1LL << (kRootBits + (level + 1) * kLevelBits))) {
+      level++;
+    }
+
+    head = &_levels[level][(expires >> (kRootBits + level * kLevelBits)) & (kLevelSize - 1)];
+  }
+
+  node->prev = head->prev;
+  node->next = head;
+  head->prev->next = node;
+  head->prev = node;
+  _count++;
+}
+
+void TimerWheel::Remove(Node *node) {
+  if (node->next) {
+    TimerWheel::Unlink(node);
+    _count--;
+  }
+}
+
+void TimerWheel::Cascade(int level, int index) {
+  Link list;
+
+  TimerWheel::Splice(&_levels[level][index], &list);
+
+  while (list.next != &list) {
+    Node *node = static_cast<Node*>(list.next);
+
+    TimerWheel::Unlink(node);
+    _count--;
+    TimerWheel::Place(node);
+  }
+}
+
+bool TimerWheel::Advance(int64_t now) {
+  bool result = false;
+
+  while (_now < now) {
+    if (!_count) {
+      _now = now;
+      break;
+    }
+
+    _now++;
+
+    int index = _now & (kRootSize - 1);
+
+    // Entering a new round of the root, bring down the timers of the next
+    // round from the level above, and from the ones above that in turn.
+
+    for (int level = 0; !index && level < kLevels; level++) {
+      index = (_now >> (kRootBits + level * kLevelBits)) & (kLevelSize - 1);
+      TimerWheel::Cascade(level, index);
+    }
+
+    Link list;
+    TimerWheel::Splice(&_root[_now & (kRootSize - 1)], &list);
+
+    while (list.next != &list) {
+      Node *node = static_cast<Node*>(list.next);
+
+      TimerWheel::Unlink(node);
+      _count--;
+      node->Expire();
+      result = true;
+    }
+  }
+
+  return result;
+}
+
+int TimerWheel::Next() const {
+  if (!_count) {
+    return -1;
+  }
+
+  for (int delta = 1; delta <= kRootSize; delta++) {
+    int64_t tick = _now + delta;
+    const Link *head = &_root[tick & (kRootSize - 1)];
+
+    if (head->next != head || !(tick & (kRootSize - 1))) {
+      return delta;
+    }
+  }
+
+  return kRootSize;
+}
+
+TimerInternal::TimerInternal(Callback &&callback, int interval, WorkerInternal *worker) :
+  _callback(std::move(callback)),
+  _interval(interval),
+  _cleared(false),
+  _armed(false),
+  _thread(worker),
+  _listener(0)
+{
+  if (worker) {
+    _owner = Let<WorkerInternal>(worker);
+  }
+}
+
+TimerInternal::~TimerInternal() {
+
+}
+
+Let<TimerInternal> TimerInternal::New(Callback &&callback, int delay, int interval, WorkerInternal *worker, const Let<AbortSignal> &signal) {
+  Let<TimerInternal> timer = Let<TimerInternal>::New(std::move(callback), interval, worker);
+
+  // The listener is added before the timer starts, Finish() on the worker
+  // removes it again.
+
+  if (!signal.IsEmpty()) {
+    WeakLet<TimerInternal> weak(timer);
+
+    timer->_signal = signal;
+    timer->_listener = signal->AddListener([=](const Let<Error> &reason) {
+      Let<TimerInternal> timer = weak.Lock();
+
+      if (!timer.IsEmpty()) {
+        timer->Clear();
+      }
+    });
+  }
+
+  timer->Start(delay);
+  return timer;
+}
+
+void TimerInternal::Start(int delay) {
+
+  // Timer holds a reference on itself, the worker and an event until it
+  // has finished.
+
+  AddRef();
+  _event = Event::New();
+
+  if (!_thread) {
+    return Async::Call(Callback([this]() {
+      TimerInternal::Expire();
+    }), delay, Let<Worker>());
+  }
+
+  _worker = _thread;
+
+  int64_t expires = rtc::TimeMillis() + delay;
+
+  if (WorkerInternal::current_worker == _thread) {
+    return TimerInternal::Arm(expires);
+  }
+
+  Async::Call(Callback([this, expires]() {
+    TimerInternal::Arm(expires);
+  }), 0, _worker);
+}
+
+void TimerInternal::Arm(int64_t expires) {
+  if (_cleared.load()) {
+    return TimerInternal::Finish();
+  }
+
+  _armed = true;
+  _thread->_timers.Insert(this, expires);
+}
+
+void TimerInternal::Expire() {
+  _armed = false;
+
+  if (!_cleared.load()) {
+    AsyncInternal::Enter();
+    _callback();
+    AsyncInternal::Leave();
+
+    if (_interval > 0 && !_cleared.load()) {
+      if (!_thread) {
+        return Async::Call(Callback([this]() {
+          TimerInternal::Expire();
+        }), _interval, Let<Worker>());
+      }
+
+      return TimerInternal::Arm(_thread->_timers.Now() + _interval);
+    }
+  }
+
+  TimerInternal::Finish();
+}
+
+void TimerInternal::Clear() {
+  if (_cleared.exchange(true) || !_thread) {
+    return;
+  }
+
+  if (WorkerInternal::current_worker == _thread) {
+    return TimerInternal::Cancel();
+  }
+
+  Let<WorkerInternal> worker = _owner.Lock();
+
+  if (!worker.IsEmpty()) {
+    Let<TimerInternal> self(this);
+
+    Async::Call(Callback([self]() {
+      self->Cancel();
+    }), 0, worker);
+  }
+}
+
+void TimerInternal::Cancel() {
+  if (_armed) {
+    _armed = false;
+    _thread->_timers.Remove(this);
+    TimerInternal::Finish();
+  }
+}
+
+void TimerInternal::Finish() {
+  Callback callback(std::move(_callback));
+  Let<WorkerInternal> worker(std::move(_worker));
+  Let<Event> event(std::move(_event));
+  Let<AbortSignal> signal(std::move(_signal));
+
+  if (!signal.IsEmpty()) {
+    signal->RemoveListener(_listener);
+  }
+
+  RemoveRef();
+}
+
+Let<Timer> Timer::New(const Callback &callback, int delay, int interval, const Let<Worker> &worker) {
+  Let<WorkerBase> target(worker);
+  Callback runnable(callback);
+
+  return TimerInternal::New(std::move(runnable), (delay > 0) ? delay : 0, (interval > 0) ? interval : 0, (!target.IsEmpty()) ? target->Target() : nullptr);
+}
+
+Let<Timer> Timer::New(const Callback &callback, int delay, int interval, const Let<Worker> &worker, const Let<AbortSignal> &signal) {
+  Let<WorkerBase> target(worker);
+  Callback runnable(callback);
+
+  return TimerInternal::New(std::move(runnable), (delay > 0) ? delay : 0, (interval > 0) ? interval : 0, (!target.IsEmpty()) ? target->Target() : nullptr, signal);
+}
\ No newline at end of file
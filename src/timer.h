@@ -0,0 +1,137 @@
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2017 vmolsa <ville.molsa@gmail.com> (http://github.com/vmolsa)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#ifndef CRTC_TIMER_H
+#define CRTC_TIMER_H
+
+#include "crtc.h"
+
+#include <atomic>
+
+namespace crtc {
+  class WorkerInternal;
+
+  // Hierarchical timing wheel with a millisecond tick. The first level has a
+  // slot for each of the next 256 ticks, the three others cover 64 times the
+  // range of the previous one each (about 18 hours). Longer timers wait in
+  // the last level and are placed again each time it comes around.
+  // Insert() and Remove() are O(1). Owned by a single thread.
+
+  class TimerWheel {
+    public:
+      class Link {
+        public:
+          Link *prev;
+          Link *next;
+      };
+
+      class Node : public Link {
+          friend class TimerWheel;
+
+        public:
+          explicit Node() : _expires(0) {
+            prev = nullptr;
+            next = nullptr;
+          }
+
+          virtual ~Node() { }
+
+          virtual void Expire() { }
+
+        private:
+          int64_t _expires;
+      };
+
+      explicit TimerWheel(int64_t now);
+
+      void Insert(Node *node, int64_t expires);
+      void Remove(Node *node);
+
+      // Runs the nodes that have expired by now, returns true if any did.
+      bool Advance(int64_t now);
+
+      // Milliseconds until the wheel has work to do, -1 when it is empty.
+      int Next() const;
+
+      inline int64_t Now() const {
+        return _now;
+      }
+
+    protected:
+      static const int kRootBits = 8;
+      static const int kRootSize = 1 << kRootBits;
+      static const int kLevelBits = 6;
+      static const int kLevelSize = 1 << kLevelBits;
+      static const int kLevels = 3;
+      static const int64_t kMaxDelta = (1LL << (kRootBits + kLevels * kLevelBits)) - 1;
+
+      static void Splice(Link *from, Link *to);
+      static void Unlink(Link *link);
+
+      void Place(Node *node);
+      void Cascade(int level, int index);
+
+      Link _root[kRootSize];
+      Link _levels[kLevels][kLevelSize];
+      int64_t _now;
+      size_t _count;
+  };
+
+  class TimerInternal : public Timer, public TimerWheel::Node {
+      friend class Timer;
+      friend class Let<TimerInternal>;
+
+    public:
+      // Aborting signal clears the timer.
+
+      static Let<TimerInternal> New(Callback &&callback, int delay, int interval, WorkerInternal *worker, const Let<AbortSignal> &signal = Let<AbortSignal>());
+
+      void Clear() override;
+
+    protected:
+      explicit TimerInternal(Callback &&callback, int interval, WorkerInternal *worker);
+      ~TimerInternal() override;
+
+      void Start(int delay);
+      void Arm(int64_t expires);
+      void Expire() override;
+      void Cancel();
+      void Finish();
+
+      Callback _callback;
+      int _interval;
+      std::atomic<bool> _cleared;
+      bool _armed;
+      WorkerInternal *_thread;
+      WeakLet<WorkerInternal> _owner;
+      Let<WorkerInternal> _worker;
+      Let<Event> _event;
+      Let<AbortSignal> _signal;
+      int _listener;
+  };
+};
+
+#endif
\ No newline at end of file
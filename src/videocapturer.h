@@ -30,6 +30,7 @@
 
 #include "crtc.h"
 #include "worker.h"
+#include "imagebuffer.h"
 
 #include "webrtc/base/timeutils.h"
 #include "webrtc/media/base/videocapturer.h"
@@ -39,6 +40,7 @@
 #include "webrtc/base/thread.h"
 #include "webrtc/base/criticalsection.h"
 #include "webrtc/base/timestampaligner.h"
+#include "libyuv/scale.h"
 
 #define AddVideoFormat(formats, x, y) \
   formats.push_back(cricket::VideoFormat(x, y, cricket::VideoFormat::FpsToInterval(120), cricket::FOURCC_I420)); \
@@ -208,10 +210,10 @@ namespace crtc {
       bool _drainNeeded;
       Let<RealTimeClock> _clock;
 
-      inline Let<Error> Write(const rtc::scoped_refptr<webrtc::VideoFrameBuffer> &buffer, int64_t timestamp) {
-        if (buffer.get()) {
-          int width = buffer->width();
-          int height = buffer->height();
+      inline Let<Error> Write(const Let<ImageBuffer> &frame, int64_t timestamp) {
+        if (!frame.IsEmpty()) {
+          int width = frame->Width();
+          int height = frame->Height();
           int adapted_width;
           int adapted_height;
           int crop_width;
@@ -229,11 +231,30 @@ namespace crtc {
             return error;
           }
 
+          // Frames that are forwarded are converted here, WebRTC has no way
+          // to tell a failed conversion from an image without planes.
+
+          rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer = WrapImageBuffer::New(frame);
+
+          if (!buffer->DataY()) {
+            return Error::New("Unable to convert VideoFrame to I420", __FILE__, __LINE__);
+          }
+
           if (width != adapted_width || height != adapted_height) {
-            rtc::scoped_refptr<webrtc::I420Buffer> i420_buffer(webrtc::I420Buffer::Create(adapted_width, adapted_height));
-            i420_buffer->ScaleFrom(*(buffer.get()));
+            // Scaled frames go to aligned pooled memory instead of a fresh
+            // I420Buffer, every row starts on a cache line for libyuv.
+
+            Let<ImageBuffer> scaled = ImageBuffer::NewAligned(adapted_width, adapted_height, ImageBufferInternal::kAlignment, 0, 0, false);
+
+            if (scaled.IsEmpty()) {
+              return Error::New("Unable to allocate VideoFrame buffer", __FILE__, __LINE__);
+            }
+
+            libyuv::I420Scale(buffer->DataY(), buffer->StrideY(), buffer->DataU(), buffer->StrideU(), buffer->DataV(), buffer->StrideV(), width, height,
+                              const_cast<uint8_t*>(scaled->DataY()), scaled->StrideY(), const_cast<uint8_t*>(scaled->DataU()), scaled->StrideU(),
+                              const_cast<uint8_t*>(scaled->DataV()), scaled->StrideV(), adapted_width, adapted_height, libyuv::kFilterBox);
 
-            return WriteFrame(webrtc::VideoFrame(i420_buffer, webrtc::kVideoRotation_0, translated_time_us), width, height);
+            return WriteFrame(webrtc::VideoFrame(WrapImageBuffer::New(scaled), webrtc::kVideoRotation_0, translated_time_us), width, height);
           } else {
             return WriteFrame(webrtc::VideoFrame(buffer, webrtc::kVideoRotation_0, translated_time_us), width, height);
           }
@@ -275,7 +296,7 @@ namespace crtc {
             } 
           }
 
-          pending.callback(Write(WrapImageBuffer::New(pending.frame), pending.timestamp));
+          pending.callback(Write(pending.frame, pending.timestamp));
 
           {
             rtc::CritScope cs(&_lock);
@@ -25,42 +25,464 @@
 
 #include "crtc.h"
 #include "worker.h"
+#include "async.h"
+#include "module.h"
 
 #include "webrtc/base/timeutils.h"
 
+#include <algorithm>
+#include <thread>
+
+#ifdef CRTC_OS_POSIX
+#include <limits.h>
+#include <sched.h>
+#endif
+
+#ifdef CRTC_OS_LINUX
+#include <poll.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+
 using namespace crtc;
 
-thread_local Let<WorkerInternal> WorkerInternal::current_worker;
+thread_local WorkerInternal *WorkerInternal::current_worker = nullptr;
 
-bool WorkerInternal::Wait(int cms, bool process_io) {
-  if (RefCount() > 1) {
-    return rtc::NullSocketServer::Wait(1000, process_io);
+void WorkerInternal::Post(WorkerTask *task) {
+  task->Stamp();
+  _queues[task->priority].Push(task);
+  WorkerInternal::Signal();
+}
+
+WorkerInternal *WorkerInternal::Target() {
+  return this;
+}
+
+Let<Worker> WorkerInternal::Key(uint64_t key) {
+  return Let<Worker>(this);
+}
+
+bool WorkerInternal::Signal() {
+  if (_sleeping.load() && _sleeping.exchange(false)) {
+    WakeUp();
+    return true;
+  }
+
+  return false;
+}
+
+bool WorkerInternal::Drain() {
+  Let<WorkerPoolInternal> pool = _pool.Lock();
+  int count = 0;
+
+  for (; count < kBatchSize; count++) {
+    WorkerTask *task = WorkerInternal::Next(pool);
+
+    if (!task) {
+      break;
+    }
+
+    WorkerInternal::Execute(task);
+  }
+
+  return (count > 0);
+}
+
+// Highest lane with work wins, except that every fourth pick starts from
+// kNormal and every sixteenth from kBackground so that lower lanes are not
+// starved by a steady stream of higher ones. Own queues come before the
+// shared lanes of the pool.
+
+WorkerTask *WorkerInternal::Next(const Let<WorkerPoolInternal> &pool) {
+  uint32_t pick = _picks++;
+  int first = (!(pick % 16)) ? kBackground : ((!(pick % 4)) ? kNormal : kRealtime);
+
+  for (int step = 0; step < kPriorities; step++) {
+    int priority = (!step) ? first : ((step - 1 < first) ? step - 1 : step);
+    WorkerTask *task = static_cast<WorkerTask*>(_queues[priority].Pop());
+
+    if (!task && !pool.IsEmpty()) {
+      task = pool->Take(_lane, priority);
+    }
+
+    if (task) {
+      return task;
+    }
+  }
+
+  return nullptr;
+}
+
+// Timed tasks are timed twice, for the delay and for the run time. Busy
+// time comes from the time spent sleeping, not from the tasks.
+
+void WorkerInternal::Execute(WorkerTask *task) {
+  if (task->Cancelled()) {
+    delete task;
+    return;
+  }
+
+  WorkerCounters::Lane &lane = _counters.lanes[task->priority];
+  int64_t now = (task->queued) ? rtc::TimeMicros() : 0;
+
+  if (task->deadline && now > task->deadline) {
+    WorkerCounters::Count(lane.expired);
+  } else {
+    WorkerCounters::Count(lane.tasks);
+    task->Run();
+
+    if (task->queued) {
+      WorkerCounters::Count(lane.delay[Log2Bucket(now - task->queued, kBuckets)]);
+      WorkerCounters::Count(_counters.runtime[Log2Bucket(rtc::TimeMicros() - now, kBuckets)]);
+    }
+  }
+
+  delete task;
+}
+
+Worker::WorkerStats WorkerInternal::Stats() const {
+  int64_t now = rtc::TimeMicros();
+  int64_t since = _sleeping_since.load(std::memory_order_relaxed);
+  uint64_t idle = _counters.idle.load(std::memory_order_relaxed);
+  WorkerStats stats;
+
+  _counters.Sample(&stats, now);
+
+  if (since > 0 && now > since) {
+    idle += now - since;
+  }
+
+  for (const TaskQueue &queue : _queues) {
+    stats.depth += queue.Size();
+  }
+
+  stats.busy = (stats.uptime > idle) ? stats.uptime - idle : 0;
+  return stats;
+}
+
+bool WorkerInternal::Pending() {
+  for (const TaskQueue &queue : _queues) {
+    if (!queue.Empty()) {
+      return true;
+    }
+  }
+
+  Let<WorkerPoolInternal> pool = _pool.Lock();
+
+  if (!pool.IsEmpty()) {
+    for (const std::atomic<int> &pending : pool->_pending) {
+      if (pending.load() > 0) {
+        return true;
+      }
+    }
   }
 
   return false;
+}
+
+bool WorkerInternal::Watch(int fd, int events, const WatchCallback &callback) {
+#ifdef CRTC_OS_LINUX
+  if (fd < 0 || callback.IsEmpty()) {
+    return false;
+  }
+
+  struct epoll_event event = {};
+
+  event.events = ((events & kReadable) ? EPOLLIN : 0) | ((events & kWritable) ? EPOLLOUT : 0);
+  event.data.fd = fd;
+
+  rtc::CritScope cs(&_lock);
+
+  if (epoll_ctl(_epoll, _watchers.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) < 0) {
+    return false;
+  }
+
+  _watchers[fd] = callback;
+  _watching.store(_watchers.size());
+  return true;
+#else
+  return false;
+#endif
+}
+
+void WorkerInternal::Unwatch(int fd) {
+#ifdef CRTC_OS_LINUX
+  rtc::CritScope cs(&_lock);
+
+  if (_watchers.erase(fd)) {
+    epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    _watching.store(_watchers.size());
+  }
+#endif
+}
+
+#ifdef CRTC_OS_LINUX
+
+// Waits up to cms for the wakeup or a watched descriptor and keeps the
+// ready ones in _events for Notify(), the wakeup is consumed right away.
+
+int WorkerInternal::Poll(int cms) {
+  int count = epoll_wait(_epoll, _events, kMaxEvents, cms);
+  int ready = 0;
+
+  for (int index = 0; index < count; index++) {
+    if (_events[index].data.fd == _wakeup) {
+      uint64_t value;
+
+      if (read(_wakeup, &value, sizeof(value)) < 0) {
+        // EAGAIN, another wakeup was already consumed.
+      }
+    } else {
+      _events[ready++] = _events[index];
+    }
+  }
+
+  return ready;
+}
+
+// Callbacks are looked up at the time they run, one unwatched by an earlier
+// callback of the same batch is skipped.
+
+void WorkerInternal::Notify(int count) {
+  for (int index = 0; index < count; index++) {
+    int fd = _events[index].data.fd;
+    uint32_t flags = _events[index].events;
+    WatchCallback callback;
+
+    {
+      rtc::CritScope cs(&_lock);
+      auto it = _watchers.find(fd);
+
+      if (it == _watchers.end()) {
+        continue;
+      }
+
+      callback = it->second;
+    }
+
+    int events = ((flags & EPOLLIN) ? kReadable : 0) |
+                 ((flags & EPOLLOUT) ? kWritable : 0) |
+                 ((flags & (EPOLLERR | EPOLLHUP)) ? kError : 0);
+
+    AsyncInternal::Enter();
+    callback(fd, events);
+    AsyncInternal::Leave();
+  }
+}
+#endif
+
+// rtc::Thread::Send() and Invoke() wait here with process_io false while
+// the task that called them is still running, and a task may run a message
+// loop of its own. Only the outermost wait runs tasks, timers and watchers
+// and gives up the reference of the worker, nested ones just sleep until
+// they are woken up.
+
+bool WorkerInternal::Wait(int cms, bool process_io) {
+  if (_processing || !process_io) {
+    return WorkerInternal::Sleep(cms, process_io);
+  }
+
+  _processing = true;
+  bool result = WorkerInternal::Process(cms);
+  _processing = false;
+
+  return result;
+}
+
+bool WorkerInternal::Sleep(int cms, bool process_io) {
+#ifdef CRTC_OS_LINUX
+  struct pollfd fd = { _wakeup, POLLIN, 0 };
+
+  if (poll(&fd, 1, cms) > 0) {
+    uint64_t value;
+
+    if (read(_wakeup, &value, sizeof(value)) < 0) {
+      // EAGAIN, another wakeup was already consumed.
+    }
+  }
+
+  return true;
+#else
+  return rtc::NullSocketServer::Wait(cms, process_io);
+#endif
+}
+
+bool WorkerInternal::Process(int cms) {
+  bool busy = WorkerInternal::Drain();
+
+  if (_timers.Advance(rtc::TimeMillis())) {
+    busy = true;
+  }
+
+#ifdef CRTC_OS_LINUX
+  int ready = 0;
+
+  // Busy worker still looks at its descriptors between batches.
+
+  if (_watching.load() && (ready = WorkerInternal::Poll(0)) > 0) {
+    WorkerInternal::Notify(ready);
+    busy = true;
+  }
+#endif
+
+  if (busy || !cms) {
+    return true;
+  }
+
+  int next = _timers.Next();
+
+  if (next >= 0 && (cms < 0 || next < cms)) {
+    cms = next;
+  }
+
+  // Producers only signal a sleeping worker, check the queue once more after
+  // announcing the sleep so that a task pushed in between is not missed.
+
+  _sleeping.store(true);
+
+  if (!WorkerInternal::Pending()) {
+
+    // Sleeping worker gives up the reference it holds on itself, dropping
+    // the last one from outside runs the destructor and Stop() wakes us up.
+
+    if (!TryRemoveRef()) {
+      _sleeping.store(false);
+      return false;
+    }
+
+    int64_t since = rtc::TimeMicros();
+    _sleeping_since.store(since, std::memory_order_relaxed);
+
+#ifdef CRTC_OS_LINUX
+    ready = WorkerInternal::Poll(cms);
+#else
+    rtc::NullSocketServer::Wait(cms, true);
+#endif
+
+    _sleeping_since.store(0, std::memory_order_relaxed);
+    WorkerCounters::Count(_counters.idle, rtc::TimeMicros() - since);
+
+    if (!TryAddRef()) {
+      _released = true;
+      return false;
+    }
+  }
+
+  _sleeping.store(false);
+
+#ifdef CRTC_OS_LINUX
+  WorkerInternal::Notify(ready);
+#endif
+
+  WorkerInternal::Drain();
+  _timers.Advance(rtc::TimeMillis());
+  return true;
 };
 
+void WorkerInternal::WakeUp() {
+#ifdef CRTC_OS_LINUX
+  uint64_t value = 1;
+
+  if (write(_wakeup, &value, sizeof(value)) < 0) {
+    // EAGAIN, counter is saturated and the worker is going to wake up anyway.
+  }
+#else
+  rtc::NullSocketServer::WakeUp();
+#endif
+}
+
 void WorkerInternal::Run() {
+  ThreadOptions::Apply(_options);
+
   WorkerInternal::current_worker = this;
   ProcessMessages(rtc::ThreadManager::kForever);
-  WorkerInternal::current_worker.Dispose();
+  WorkerInternal::current_worker = nullptr;
+
+  if (!_released) {
+    RemoveRef();
+  }
 }
 
-WorkerInternal::WorkerInternal() : rtc::NullSocketServer(), rtc::Thread(this) {
+bool WorkerInternal::Launch(const WorkerOptions &options) {
+  bool started = false;
+
+  _options = options;
+
+  if (!_options.name.empty()) {
+    SetName(_options.name, nullptr);
+  }
+
+  _counters.started.store(rtc::TimeMicros());
+  AddRef();
+
+  {
+    ThreadOptions::Stack stack(_options.stackSize);
+    started = rtc::Thread::Start();
+  }
+
+  if (!started) {
+    RemoveRef();
+    return false;
+  }
+
+  return true;
+}
+
+WorkerInternal::WorkerInternal() :
+  rtc::NullSocketServer(),
+  rtc::Thread(this),
+  _sleeping_since(0),
+  _picks(1),
+  _timers(rtc::TimeMillis()),
+  _sleeping(false),
+  _released(false),
+  _processing(false),
+  _lane(0)
+#ifdef CRTC_OS_LINUX
+  , _wakeup(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+  , _epoll(epoll_create1(EPOLL_CLOEXEC))
+  , _watching(0)
+#endif
+{
+#ifdef CRTC_OS_LINUX
+  struct epoll_event event = {};
+
+  event.events = EPOLLIN;
+  event.data.fd = _wakeup;
+  epoll_ctl(_epoll, EPOLL_CTL_ADD, _wakeup, &event);
+#endif
+
   SetName("worker", nullptr);
 }
 
 WorkerInternal::~WorkerInternal() {
   rtc::Thread::Stop();
+
+  for (TaskQueue &queue : _queues) {
+    while (!queue.Empty()) {
+      delete queue.Pop();
+    }
+  }
+
+#ifdef CRTC_OS_LINUX
+  close(_epoll);
+  close(_wakeup);
+#endif
 }
 
 Let<Worker> Worker::New(const Callback &runnable) {
+  return Worker::New(WorkerOptions(), runnable);
+}
+
+Let<Worker> Worker::New(const WorkerOptions &options, const Callback &runnable) {
   Let<WorkerInternal> worker = Let<WorkerInternal>::New();
   
   if (!worker.IsEmpty()) {
-    rtc::Thread *thread = worker;
-
-    if (thread->Start()) {
+    if (worker->Launch(options)) {
       if (!runnable.IsEmpty()) {
         Async::Call(runnable, 0, worker);
       }
@@ -72,46 +494,749 @@ Let<Worker> Worker::New(const Callback &runnable) {
   return Let<Worker>();
 }
 
+WorkerPoolInternal::WorkerPoolInternal(int threads) : _next(0) {
+  for (std::atomic<int> &pending : _pending) {
+    pending.store(0);
+  }
+
+  for (int index = 0; index < threads; index++) {
+    std::unique_ptr<Lane> lane(new Lane());
+    lane->worker = Let<WorkerInternal>::New();
+    _lanes.push_back(std::move(lane));
+  }
+}
+
+WorkerPoolInternal::~WorkerPoolInternal() {
+  for (auto &lane : _lanes) {
+    Let<WorkerInternal> worker = std::move(lane->worker);
+
+    {
+      rtc::CritScope cs(&lane->lock);
+
+      for (std::deque<WorkerTask*> &tasks : lane->tasks) {
+        for (WorkerTask *task : tasks) {
+          delete task;
+        }
+
+        tasks.clear();
+      }
+    }
+  }
+}
+
+void WorkerPoolInternal::Post(WorkerTask *task) {
+  size_t index = _next.fetch_add(1, std::memory_order_relaxed) % _lanes.size();
+  Lane *lane = _lanes[index].get();
+
+  task->Stamp();
+
+  {
+    rtc::CritScope cs(&lane->lock);
+    lane->tasks[task->priority].push_back(task);
+  }
+
+  _pending[task->priority].fetch_add(1);
+
+  // Prefer the owner of the lane, any sleeping thread is able to steal it.
+
+  for (size_t step = 0; step < _lanes.size(); step++) {
+    if (_lanes[(index + step) % _lanes.size()]->worker->Signal()) {
+      break;
+    }
+  }
+}
+
+WorkerInternal *WorkerPoolInternal::Target() {
+  return _lanes[_next.fetch_add(1, std::memory_order_relaxed) % _lanes.size()]->worker;
+}
+
+Let<Worker> WorkerPoolInternal::Key(uint64_t key) {
+  return _lanes[((key * 0x9E3779B97F4A7C15ULL) >> 32) % _lanes.size()]->worker;
+}
+
+bool WorkerPoolInternal::Watch(int fd, int events, const WatchCallback &callback) {
+  return WorkerPoolInternal::Key(fd)->Watch(fd, events, callback);
+}
+
+void WorkerPoolInternal::Unwatch(int fd) {
+  WorkerPoolInternal::Key(fd)->Unwatch(fd);
+}
+
+Worker::WorkerStats WorkerPoolInternal::Stats() const {
+  WorkerStats stats = {};
+
+  for (const std::unique_ptr<Lane> &lane : _lanes) {
+    WorkerStats thread = lane->worker->Stats();
+
+    for (int priority = 0; priority < kPriorities; priority++) {
+      stats.lanes[priority].tasks += thread.lanes[priority].tasks;
+      stats.lanes[priority].expired += thread.lanes[priority].expired;
+
+      for (int bucket = 0; bucket < kBuckets; bucket++) {
+        stats.lanes[priority].delay[bucket] += thread.lanes[priority].delay[bucket];
+      }
+    }
+
+    for (int bucket = 0; bucket < kBuckets; bucket++) {
+      stats.runtime[bucket] += thread.runtime[bucket];
+    }
+
+    stats.depth += thread.depth;
+    stats.busy += thread.busy;
+    stats.uptime += thread.uptime;
+  }
+
+  for (const std::atomic<int> &pending : _pending) {
+    stats.depth += std::max(pending.load(std::memory_order_relaxed), 0);
+  }
+
+  return stats;
+}
+
+WorkerTask *WorkerPoolInternal::Take(size_t index, int priority) {
+  if (_pending[priority].load(std::memory_order_relaxed) <= 0) {
+    return nullptr;
+  }
+
+  // Own lane is served from the front, other lanes are stolen from the back.
+
+  for (size_t step = 0; step < _lanes.size(); step++) {
+    Lane *lane = _lanes[(index + step) % _lanes.size()].get();
+    WorkerTask *task = nullptr;
+
+    {
+      rtc::CritScope cs(&lane->lock);
+      std::deque<WorkerTask*> &tasks = lane->tasks[priority];
+
+      if (!tasks.empty()) {
+        if (!step) {
+          task = tasks.front();
+          tasks.pop_front();
+        } else {
+          task = tasks.back();
+          tasks.pop_back();
+        }
+      }
+    }
+
+    if (task) {
+      _pending[priority].fetch_sub(1);
+      return task;
+    }
+  }
+
+  return nullptr;
+}
+
+Let<Worker> Worker::NewPool(int threads) {
+  return Worker::NewPool(threads, WorkerOptions());
+}
+
+Let<Worker> Worker::NewPool(int threads, const WorkerOptions &options) {
+  if (threads <= 0) {
+    threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+  }
+
+  Let<WorkerPoolInternal> pool = Let<WorkerPoolInternal>::New(threads);
+
+  for (size_t index = 0; index < pool->_lanes.size(); index++) {
+    Let<WorkerInternal> worker = pool->_lanes[index]->worker;
+    WorkerOptions thread(options);
+
+    if (!options.name.empty()) {
+      thread.name = options.name + "-" + std::to_string(index);
+    }
+
+    worker->_pool = pool;
+    worker->_lane = index;
+
+    if (!worker->Launch(thread)) {
+      return Let<Worker>();
+    }
+  }
+
+  return pool;
+}
+
 Let<Worker> Worker::This() {
-  return WorkerInternal::current_worker;
+  return Let<Worker>(WorkerInternal::current_worker);
+}
+
+ThreadOptions::Stack::Stack(size_t size) : _changed(false) {
+#if defined(CRTC_OS_LINUX) && defined(__GLIBC__)
+  if (size > 0) {
+    pthread_attr_t attr;
+
+    // Default attributes are process wide, one stack size at a time.
+
+    ThreadOptions::Lock()->Enter();
+
+    if (!pthread_getattr_default_np(&_attr)) {
+      if (!pthread_getattr_default_np(&attr)) {
+        pthread_attr_setstacksize(&attr, std::max(size, static_cast<size_t>(PTHREAD_STACK_MIN)));
+        _changed = !pthread_setattr_default_np(&attr);
+        pthread_attr_destroy(&attr);
+      }
+
+      if (!_changed) {
+        pthread_attr_destroy(&_attr);
+      }
+    }
+
+    if (!_changed) {
+      ThreadOptions::Lock()->Leave();
+    }
+  }
+#endif
+}
+
+ThreadOptions::Stack::~Stack() {
+#if defined(CRTC_OS_LINUX) && defined(__GLIBC__)
+  if (_changed) {
+    pthread_setattr_default_np(&_attr);
+    pthread_attr_destroy(&_attr);
+    ThreadOptions::Lock()->Leave();
+  }
+#endif
+}
+
+rtc::CriticalSection *ThreadOptions::Lock() {
+  static rtc::CriticalSection *lock = new rtc::CriticalSection();
+  return lock;
+}
+
+void ThreadOptions::Apply(const Worker::WorkerOptions &options) {
+#ifdef CRTC_OS_LINUX
+  if (!options.affinity.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+
+    for (int cpu : options.affinity) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &cpus);
+      }
+    }
+
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+  }
+#endif
+
+#ifdef CRTC_OS_POSIX
+  struct sched_param param = {};
+
+  switch (options.policy) {
+    case Worker::kPolicyFifo:
+    case Worker::kPolicyRoundRobin:
+      param.sched_priority = options.priority;
+      pthread_setschedparam(pthread_self(), (options.policy == Worker::kPolicyFifo) ? SCHED_FIFO : SCHED_RR, &param);
+      break;
+#ifdef CRTC_OS_LINUX
+    case Worker::kPolicyOther:
+    case Worker::kPolicyBatch:
+    case Worker::kPolicyIdle:
+      pthread_setschedparam(pthread_self(), (options.policy == Worker::kPolicyOther) ? SCHED_OTHER :
+                                            (options.policy == Worker::kPolicyBatch) ? SCHED_BATCH : SCHED_IDLE, &param);
+
+      // Nice value is per thread on Linux.
+
+      if (options.policy != Worker::kPolicyIdle) {
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options.priority);
+      }
+
+      break;
+#endif
+    default:
+      break;
+  }
+#endif
+}
+
+WorkerCounters::WorkerCounters() : busy(0), idle(0), started(0) {
+  for (Lane &lane : lanes) {
+    lane.tasks.store(0);
+    lane.expired.store(0);
+
+    for (std::atomic<uint64_t> &bucket : lane.delay) {
+      bucket.store(0);
+    }
+  }
+
+  for (std::atomic<uint64_t> &bucket : runtime) {
+    bucket.store(0);
+  }
+}
+
+void WorkerCounters::Sample(Worker::WorkerStats *stats, int64_t now) const {
+  int64_t start = started.load(std::memory_order_relaxed);
+
+  for (int priority = 0; priority < Worker::kPriorities; priority++) {
+    const Lane &counters = lanes[priority];
+    Worker::LaneStats &lane = stats->lanes[priority];
+
+    lane.tasks = counters.tasks.load(std::memory_order_relaxed);
+    lane.expired = counters.expired.load(std::memory_order_relaxed);
+
+    for (int bucket = 0; bucket < Worker::kBuckets; bucket++) {
+      lane.delay[bucket] = counters.delay[bucket].load(std::memory_order_relaxed);
+    }
+  }
+
+  for (int bucket = 0; bucket < Worker::kBuckets; bucket++) {
+    stats->runtime[bucket] = runtime[bucket].load(std::memory_order_relaxed);
+  }
+
+  stats->depth = 0;
+  stats->busy = busy.load(std::memory_order_relaxed);
+  stats->uptime = (start > 0 && now > start) ? now - start : 0;
+}
+
+uint64_t Worker::Percentile(const uint64_t (&histogram)[kBuckets], double percentile) {
+  uint64_t samples = 0, seen = 0;
+
+  for (uint64_t count : histogram) {
+    samples += count;
+  }
+
+  for (int bucket = 0; bucket < kBuckets && samples; bucket++) {
+    seen += histogram[bucket];
+
+    if (seen * 100.0 >= samples * percentile) {
+      return (bucket) ? (1ULL << bucket) : 0;
+    }
+  }
+
+  return 0;
+}
+
+MonitoredThread::MonitoredThread(std::unique_ptr<rtc::SocketServer> ss) :
+  rtc::Thread(std::move(ss)),
+  _live(0)
+{ }
+
+MonitoredThread::~MonitoredThread() {
+  rtc::Thread::Stop();
+
+  // Stamps left in the queue unregister themselves, do it while _stamps
+  // is still there.
+
+  MonitoredThread::Clear(nullptr);
+}
+
+std::unique_ptr<MonitoredThread> MonitoredThread::Create() {
+  return std::unique_ptr<MonitoredThread>(new MonitoredThread(std::unique_ptr<rtc::SocketServer>(new rtc::NullSocketServer())));
+}
+
+std::unique_ptr<MonitoredThread> MonitoredThread::CreateWithSocketServer() {
+  return std::unique_ptr<MonitoredThread>(new MonitoredThread(rtc::SocketServer::CreateDefault()));
+}
+
+bool MonitoredThread::Launch(const Worker::WorkerOptions &options, const std::string &name) {
+  _options = options;
+  _counters.started.store(rtc::TimeMicros());
+  SetName(_options.name.empty() ? name : _options.name, nullptr);
+
+  ThreadOptions::Stack stack(_options.stackSize);
+  return rtc::Thread::Start();
+}
+
+void MonitoredThread::Run() {
+  ThreadOptions::Apply(_options);
+  rtc::Thread::Run();
+}
+
+MonitoredThread::Stamp::Stamp(MonitoredThread *thread, rtc::MessageData *data) :
+  thread(thread),
+  data(data),
+  queued(rtc::TimeMicros())
+{ }
+
+// Deleted by the message queue when the message is dropped, before
+// Unwrap() has taken the payload back.
+
+MonitoredThread::Stamp::~Stamp() {
+  if (thread) {
+    rtc::CritScope cs(&thread->_lock);
+
+    if (thread->_stamps.erase(this)) {
+      thread->_live.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  delete data;
+}
+
+void MonitoredThread::Post(const rtc::Location &posted_from, rtc::MessageHandler *handler, uint32_t id, rtc::MessageData *data, bool time_sensitive) {
+  static thread_local uint32_t count = 0;
+
+  if (count++ % WorkerTask::kSampling) {
+    return rtc::Thread::Post(posted_from, handler, id, data, time_sensitive);
+  }
+
+  Stamp *stamp = new Stamp(this, data);
+
+  {
+    rtc::CritScope cs(&_lock);
+    _stamps.insert(stamp);
+    _live.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  rtc::Thread::Post(posted_from, handler, id, stamp, time_sensitive);
+}
+
+// The queue hands messages over under its own lock, a stamped message is
+// never seen before the count that includes it.
+
+int64_t MonitoredThread::Unwrap(rtc::Message *msg) {
+  if (!msg->pdata || !_live.load(std::memory_order_relaxed)) {
+    return 0;
+  }
+
+  {
+    rtc::CritScope cs(&_lock);
+
+    if (!_stamps.erase(msg->pdata)) {
+      return 0;
+    }
+
+    _live.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  Stamp *stamp = static_cast<Stamp*>(msg->pdata);
+  int64_t queued = stamp->queued;
+
+  msg->pdata = stamp->data;
+  stamp->thread = nullptr;
+  stamp->data = nullptr;
+
+  delete stamp;
+  return queued;
+}
+
+void MonitoredThread::Dispatch(rtc::Message *msg) {
+  WorkerCounters::Lane &lane = _counters.lanes[Worker::kNormal];
+  int64_t queued = MonitoredThread::Unwrap(msg);
+  int64_t begin = rtc::TimeMicros();
+
+  if (queued) {
+    WorkerCounters::Count(lane.delay[Log2Bucket(begin - queued, Worker::kBuckets)]);
+  }
+
+  rtc::Thread::Dispatch(msg);
+
+  int64_t elapsed = rtc::TimeMicros() - begin;
+
+  WorkerCounters::Count(lane.tasks);
+  WorkerCounters::Count(_counters.runtime[Log2Bucket(elapsed, Worker::kBuckets)]);
+  WorkerCounters::Count(_counters.busy, elapsed);
+}
+
+// Messages handed to the caller get their own payload back, the ones that
+// are deleted take it with them.
+
+void MonitoredThread::Clear(rtc::MessageHandler *handler, uint32_t id, rtc::MessageList *removed) {
+  rtc::Thread::Clear(handler, id, removed);
+
+  if (removed) {
+    for (rtc::Message &msg : *removed) {
+      MonitoredThread::Unwrap(&msg);
+    }
+  }
 }
 
-RealTimeClockInternal::RealTimeClockInternal(const Callback &runnable) :
-  _tick(webrtc::EventTimerWrapper::Create()),
-  _thread(RealTimeClockInternal::Run, this, "RealTimeClock"),
-  _runnable(runnable)
+// Invoke() from other threads runs here instead of Dispatch(), counts as
+// busy time only.
+
+void MonitoredThread::ReceiveSends() {
+  int64_t begin = rtc::TimeMicros();
+  rtc::Thread::ReceiveSends();
+  WorkerCounters::Count(_counters.busy, rtc::TimeMicros() - begin);
+}
+
+Worker::WorkerStats MonitoredThread::Stats() const {
+  Worker::WorkerStats stats;
+
+  _counters.Sample(&stats, rtc::TimeMicros());
+  stats.depth = size();
+  return stats;
+}
+
+RealTimeClockThread::RealTimeClockThread(const Worker::WorkerOptions &options) :
+  _clocks(0),
+#ifdef CRTC_OS_LINUX
+  _timer(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)),
+  _wakeup(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+#else
+  _wakeup(false, false),
+#endif
+  _options(options),
+  _configured(false),
+  _stopping(false),
+  _thread(RealTimeClockThread::Run, this, options.name.empty() ? "RealTimeClock" : options.name.c_str())
 {
-  
+  _thread.Start();
+
+  if (_options.policy == Worker::kPolicyDefault) {
+    _thread.SetPriority(rtc::kHighPriority);
+  }
 }
 
-bool RealTimeClockInternal::Run(void* obj) {
-  Let<RealTimeClockInternal> clock(static_cast<RealTimeClockInternal*>(obj));
- 
-  clock->_signal = rtc::CurrentThreadId();
-  clock->_runnable();
-  clock->_tick->Wait(WEBRTC_EVENT_INFINITE);
-  
-  return true;
+// The thread may be asleep without a deadline, Stop() would wait for it
+// forever unless it is woken up first.
+
+RealTimeClockThread::~RealTimeClockThread() {
+  _stopping.store(true);
+  RealTimeClockThread::WakeUp();
+  _thread.Stop();
+
+#ifdef CRTC_OS_LINUX
+  close(_timer);
+  close(_wakeup);
+#endif
+}
+
+void RealTimeClockThread::Schedule(const Let<RealTimeClockInternal> &clock, uint32_t interval_ms, uint32_t generation) {
+  Entry entry;
+
+  entry.deadline = rtc::TimeNanos();
+  entry.interval = static_cast<int64_t>((interval_ms > 0) ? interval_ms : 1) * rtc::kNumNanosecsPerMillisec;
+  entry.generation = generation;
+  entry.clock = clock;
+
+  _clocks++;
+
+  {
+    rtc::CritScope cs(&_lock);
+    _entries.push(entry);
+  }
+
+  RealTimeClockThread::WakeUp();
+}
+
+void RealTimeClockThread::Release() {
+  _clocks--;
+}
+
+bool RealTimeClockThread::Run(void* obj) {
+  RealTimeClockThread *thread = static_cast<RealTimeClockThread*>(obj);
+
+  if (!thread->_configured) {
+    thread->_configured = true;
+    ThreadOptions::Apply(thread->_options);
+  }
+
+  thread->Process();
+  return !thread->_stopping.load();
+}
+
+void RealTimeClockThread::Process() {
+  int64_t deadline = -1;
+  Entry entry;
+
+  {
+    rtc::CritScope cs(&_lock);
+
+    if (!_entries.empty()) {
+      if (_entries.top().deadline <= rtc::TimeNanos()) {
+        entry = _entries.top();
+        _entries.pop();
+      } else {
+        deadline = _entries.top().deadline;
+      }
+    }
+  }
+
+  if (entry.clock.IsEmpty()) {
+    if (!_stopping.load()) {
+      RealTimeClockThread::Sleep(deadline);
+    }
+
+    return;
+  }
+
+  Let<RealTimeClockInternal> clock = entry.clock.Lock();
+
+  if (clock.IsEmpty()) {
+    return;
+  }
+
+  entry.deadline = clock->Tick(entry.generation, entry.deadline, entry.interval);
+
+  if (entry.deadline < 0) {
+    return;
+  }
+
+  rtc::CritScope cs(&_lock);
+
+  if (clock->_generation.load() == entry.generation) {
+    _entries.push(entry);
+  }
+}
+
+// Sleeps until the absolute deadline on the monotonic clock or until a new
+// entry is scheduled, forever when deadline is negative.
+
+void RealTimeClockThread::Sleep(int64_t deadline) {
+#ifdef CRTC_OS_LINUX
+  struct itimerspec spec = {};
+
+  if (deadline >= 0) {
+    spec.it_value.tv_sec = deadline / rtc::kNumNanosecsPerSec;
+    spec.it_value.tv_nsec = deadline % rtc::kNumNanosecsPerSec;
+
+    if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec) {
+      spec.it_value.tv_nsec = 1;  // all zeros would disarm the timer
+    }
+  }
+
+  timerfd_settime(_timer, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+  struct pollfd fds[2] = {
+    { _timer, POLLIN, 0 },
+    { _wakeup, POLLIN, 0 },
+  };
+
+  if (poll(fds, 2, -1) > 0) {
+    uint64_t value;
+
+    for (const struct pollfd &fd : fds) {
+      if ((fd.revents & POLLIN) && read(fd.fd, &value, sizeof(value)) < 0) {
+        // EAGAIN, nothing to consume.
+      }
+    }
+  }
+#else
+  int wait = rtc::Event::kForever;
+
+  if (deadline >= 0) {
+    int64_t now = rtc::TimeNanos();
+    wait = static_cast<int>((std::max(deadline - now, static_cast<int64_t>(0)) + rtc::kNumNanosecsPerMillisec - 1) / rtc::kNumNanosecsPerMillisec);
+  }
+
+  _wakeup.Wait(wait);
+#endif
+}
+
+void RealTimeClockThread::WakeUp() {
+#ifdef CRTC_OS_LINUX
+  uint64_t value = 1;
+
+  if (write(_wakeup, &value, sizeof(value)) < 0) {
+    // EAGAIN, counter is saturated and the thread is going to wake up anyway.
+  }
+#else
+  _wakeup.Set();
+#endif
+}
+
+RealTimeClockInternal::RealTimeClockInternal(const Callback &runnable, Policy policy) :
+  _running(false),
+  _generation(0),
+  _thread(nullptr),
+  _stats(),
+  _runnable(runnable),
+  _policy(policy)
+{
+
 }
 
 RealTimeClockInternal::~RealTimeClockInternal() {
   Stop();
 }
 
+RealTimeClockThread *RealTimeClockInternal::Pick() {
+
+  // Created once and never deleted, clocks may still be stopped during
+  // static destruction.
+
+  static std::vector<RealTimeClockThread*> *threads = []() {
+    size_t count = std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+    std::vector<RealTimeClockThread*> *threads = new std::vector<RealTimeClockThread*>();
+
+    for (size_t index = 0; index < std::min(count, kMaxThreads); index++) {
+      threads->push_back(new RealTimeClockThread(ModuleInternal::options.clock));
+    }
+
+    return threads;
+  }();
+
+  RealTimeClockThread *result = threads->front();
+
+  for (RealTimeClockThread *thread : *threads) {
+    if (thread->Clocks() < result->Clocks()) {
+      result = thread;
+    }
+  }
+
+  return result;
+}
+
+// Runs one tick that was due at deadline and returns the deadline of the
+// next one, or -1 if the clock was stopped or restarted in the meantime.
+// Next deadline is counted from the previous one so that the clock does not
+// drift.
+
+int64_t RealTimeClockInternal::Tick(uint32_t generation, int64_t deadline, int64_t interval) {
+  rtc::CritScope cs(&_lock);
+
+  if (_generation.load() != generation) {
+    return -1;
+  }
+
+  int64_t begin = rtc::TimeNanos();
+  _runnable();
+  int64_t end = rtc::TimeNanos();
+
+  _stats.ticks++;
+  _stats.jitter[Log2Bucket((begin - deadline) / rtc::kNumNanosecsPerMicrosec, kBuckets)]++;
+
+  if (end - begin > interval) {
+    _stats.overruns++;
+    _stats.overrun[Log2Bucket((end - begin - interval) / rtc::kNumNanosecsPerMicrosec, kBuckets)]++;
+  }
+
+  deadline += interval;
+
+  // Tick is missed completely when the one after it is already due.
+
+  if (_policy == kSkip && deadline + interval <= end) {
+    int64_t missed = (end - deadline) / interval;
+
+    deadline += missed * interval;
+    _stats.missed += missed;
+    _stats.skipped[Log2Bucket(missed, kBuckets)]++;
+  }
+
+  return deadline;
+}
+
+RealTimeClock::ClockStats RealTimeClockInternal::Stats() const {
+  rtc::CritScope cs(&_lock);
+  return _stats;
+}
+
 void RealTimeClockInternal::Start(uint32_t interval_ms) {
-  if (rtc::CurrentThreadId() != _signal && !_thread.IsRunning()) {
-    _tick->StartTimer(true, interval_ms);
-    _thread.Start();
-    _thread.SetPriority(rtc::kHighPriority);
+  rtc::CritScope cs(&_lock);
+
+  if (!_running) {
+    _running = true;
+    _thread = RealTimeClockInternal::Pick();
+    _thread->Schedule(this, interval_ms, ++_generation);
   }
 }
 
+// Taking the lock waits for a tick that is already running, unless it is
+// the one calling Stop().
+
 void RealTimeClockInternal::Stop() {
-  if (rtc::CurrentThreadId() != _signal && _thread.IsRunning()) {
-    _thread.Stop();
+  rtc::CritScope cs(&_lock);
+
+  if (_running) {
+    _running = false;
+    _generation++;
+    _thread->Release();
   }
 }
 
-Let<RealTimeClock> RealTimeClock::New(const Callback &runnable) {
-  return Let<RealTimeClockInternal>::New(runnable);
+Let<RealTimeClock> RealTimeClock::New(const Callback &runnable, Policy policy) {
+  return Let<RealTimeClockInternal>::New(runnable, policy);
 }
\ No newline at end of file
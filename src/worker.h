@@ -33,43 +33,382 @@
 #include "webrtc/base/criticalsection.h"
 #include "webrtc/base/platform_thread.h"
 #include "webrtc/typedefs.h"
-#include "webrtc/system_wrappers/include/event_wrapper.h"
+#include "webrtc/base/event.h"
+#include "webrtc/base/timeutils.h"
+#include "taskqueue.h"
+#include "timer.h"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <vector>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_set>
+
+#ifdef CRTC_OS_POSIX
+#include <pthread.h>
+#endif
+
+#ifdef CRTC_OS_LINUX
+#include <sys/epoll.h>
+#endif
 
 namespace crtc {
-  class WorkerInternal : public Worker, public rtc::NullSocketServer, public rtc::Thread {
+  class WorkerInternal;
+  class WorkerPoolInternal;
+
+  // Log2 bucket of value, bucket 0 counts zeros and the last one everything
+  // past the others.
+
+  inline int Log2Bucket(int64_t value, int buckets) {
+    int bucket = 0;
+
+    while (value > 0 && bucket < buckets - 1) {
+      value >>= 1;
+      bucket++;
+    }
+
+    return bucket;
+  }
+
+  // Task posted to a worker. Times are rtc::TimeMicros(), deadline is 0 for
+  // a task that never expires and queued is 0 for a task that is not timed.
+
+  class WorkerTask : public TaskQueue::Node {
+    public:
+      explicit WorkerTask() : priority(Worker::kNormal), queued(0), deadline(0) { }
+
+      // Reading the clock costs about as much as running an empty task, so
+      // only realtime tasks, tasks with a deadline and one in kSampling of
+      // the others are timed.
+
+      static const uint32_t kSampling = 8;
+
+      // Tasks aborted while queued are dropped by the worker without being
+      // run or counted.
+
+      virtual bool Cancelled() const {
+        return false;
+      }
+
+      inline void Stamp() {
+        static thread_local uint32_t count = 0;
+
+        if (priority == Worker::kRealtime || deadline || !(count++ % kSampling)) {
+          queued = rtc::TimeMicros();
+        }
+      }
+
+      Worker::Priority priority;
+      int64_t queued;
+      int64_t deadline;
+  };
+
+  // Counters of one thread, written only by it and sampled by Stats() from
+  // any thread without locks.
+
+  class WorkerCounters {
+    public:
+      class Lane {
+        public:
+          std::atomic<uint64_t> tasks;
+          std::atomic<uint64_t> expired;
+          std::atomic<uint64_t> delay[Worker::kBuckets];
+      };
+
+      explicit WorkerCounters();
+
+      static inline void Count(std::atomic<uint64_t> &counter, uint64_t value = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+      }
+
+      // Fills everything but depth and busy, which the threads know better.
+      void Sample(Worker::WorkerStats *stats, int64_t now) const;
+
+      Lane lanes[Worker::kPriorities];
+      std::atomic<uint64_t> runtime[Worker::kBuckets];
+      std::atomic<uint64_t> busy;
+      std::atomic<uint64_t> idle;
+      std::atomic<int64_t> started;
+  };
+
+  // Worker::WorkerOptions for threads that rtc::Thread and
+  // rtc::PlatformThread create, neither of them takes a stack size or
+  // affinity.
+
+  class ThreadOptions {
+    public:
+      // Threads started while a Stack is alive get size bytes of stack,
+      // unless they ask for a size of their own.
+
+      class Stack {
+        public:
+          explicit Stack(size_t size);
+          ~Stack();
+
+        protected:
+          bool _changed;
+#if defined(CRTC_OS_LINUX) && defined(__GLIBC__)
+          pthread_attr_t _attr;
+#endif
+      };
+
+      // Sets affinity and scheduling of options on the calling thread.
+      static void Apply(const Worker::WorkerOptions &options);
+
+    protected:
+      static rtc::CriticalSection *Lock();
+  };
+
+  // Common base of single thread workers and pools. Worker must stay the
+  // first base, Let<Worker> is converted to it without a cast.
+
+  class WorkerBase : public Worker {
+    public:
+      virtual void Post(WorkerTask *task) = 0;
+
+      // Thread that runs timers and delayed tasks of this worker.
+      virtual WorkerInternal *Target() = 0;
+
+    protected:
+      explicit WorkerBase() { }
+      ~WorkerBase() override { }
+  };
+
+  class WorkerInternal : public WorkerBase, public rtc::NullSocketServer, public rtc::Thread {
       friend class Worker;
+      friend class WorkerPoolInternal;
+      friend class TimerInternal;
       friend class Let<WorkerInternal>;
 
     private:
-      static thread_local Let<WorkerInternal> current_worker;
+      static thread_local WorkerInternal *current_worker;
+
+    public:
+      void Post(WorkerTask *task) override;
+      WorkerInternal *Target() override;
+      Let<Worker> Key(uint64_t key) override;
+
+      bool Watch(int fd, int events, const WatchCallback &callback) override;
+      void Unwatch(int fd) override;
+
+      WorkerStats Stats() const override;
 
     protected:
+      static const int kBatchSize = 64;
+      static const int kMaxEvents = 64;
+
       explicit WorkerInternal();
       ~WorkerInternal() override;
 
+      bool Launch(const WorkerOptions &options);
+      bool Drain();
+      WorkerTask *Next(const Let<WorkerPoolInternal> &pool);
+      void Execute(WorkerTask *task);
+      bool Pending();
+      bool Signal();
+
+#ifdef CRTC_OS_LINUX
+      int Poll(int cms);
+      void Notify(int count);
+#endif
+
+      bool Process(int cms);
+      bool Sleep(int cms, bool process_io);
       bool Wait(int cms, bool process_io) final;
+      void WakeUp() final;
       void Run() override;
+
+      TaskQueue _queues[kPriorities];
+      WorkerCounters _counters;
+      std::atomic<int64_t> _sleeping_since;
+      uint32_t _picks;
+      TimerWheel _timers;
+      std::atomic<bool> _sleeping;
+      bool _released;
+      bool _processing;
+      WeakLet<WorkerPoolInternal> _pool;
+      size_t _lane;
+      WorkerOptions _options;
+#ifdef CRTC_OS_LINUX
+      int _wakeup;
+      int _epoll;
+      struct epoll_event _events[kMaxEvents];
+      rtc::CriticalSection _lock;
+      std::map<int, WatchCallback> _watchers GUARDED_BY(_lock);
+      std::atomic<size_t> _watching;
+#endif
+  };
+
+  // Every thread of a pool owns a lane, tasks posted to the pool are spread
+  // over the lanes and idle threads steal from the lanes of the others.
+  // Tasks posted to a thread of the pool (Key()) stay in its own queue.
+
+  class WorkerPoolInternal : public WorkerBase {
+      friend class Worker;
+      friend class WorkerInternal;
+      friend class Let<WorkerPoolInternal>;
+
+    public:
+      void Post(WorkerTask *task) override;
+      WorkerInternal *Target() override;
+      Let<Worker> Key(uint64_t key) override;
+
+      bool Watch(int fd, int events, const WatchCallback &callback) override;
+      void Unwatch(int fd) override;
+
+      WorkerStats Stats() const override;
+
+    protected:
+      class Lane {
+        public:
+          rtc::CriticalSection lock;
+          std::deque<WorkerTask*> tasks[kPriorities] GUARDED_BY(lock);
+          Let<WorkerInternal> worker;
+      };
+
+      explicit WorkerPoolInternal(int threads);
+      ~WorkerPoolInternal() override;
+
+      WorkerTask *Take(size_t lane, int priority);
+
+      std::vector<std::unique_ptr<Lane>> _lanes;
+      std::atomic<size_t> _next;
+      std::atomic<int> _pending[kPriorities];
+  };
+
+  // rtc::Thread of the library that counts what it dispatches for
+  // Module::Stats(). One in WorkerTask::kSampling posts has its payload
+  // wrapped in a Stamp that carries the time it was queued. Dispatch() and
+  // Clear() hand the original payload back before anyone else sees it.
+  // Marking posts time sensitive instead would log every late message.
+
+  class MonitoredThread : public rtc::Thread {
+    public:
+      explicit MonitoredThread(std::unique_ptr<rtc::SocketServer> ss);
+      ~MonitoredThread() override;
+
+      static std::unique_ptr<MonitoredThread> Create();
+      static std::unique_ptr<MonitoredThread> CreateWithSocketServer();
+
+      bool Launch(const Worker::WorkerOptions &options, const std::string &name);
+      void Run() override;
+
+      void Post(const rtc::Location &posted_from, rtc::MessageHandler *handler, uint32_t id, rtc::MessageData *data, bool time_sensitive) override;
+      void Dispatch(rtc::Message *msg) override;
+      void Clear(rtc::MessageHandler *handler, uint32_t id = rtc::MQID_ANY, rtc::MessageList *removed = nullptr) override;
+      void ReceiveSends() override;
+
+      Worker::WorkerStats Stats() const;
+
+    protected:
+      class Stamp : public rtc::MessageData {
+        public:
+          explicit Stamp(MonitoredThread *thread, rtc::MessageData *data);
+          ~Stamp() override;
+
+          MonitoredThread *thread;
+          rtc::MessageData *data;
+          int64_t queued;
+      };
+
+      // Puts the original payload back into msg, returns the time it was
+      // queued or 0 when msg was not stamped.
+
+      int64_t Unwrap(rtc::Message *msg);
+
+      WorkerCounters _counters;
+      Worker::WorkerOptions _options;
+      rtc::CriticalSection _lock;
+      std::unordered_set<const rtc::MessageData*> _stamps GUARDED_BY(_lock);
+
+      // Size of _stamps, Unwrap() only takes the lock when it is not zero.
+      std::atomic<size_t> _live;
+  };
+
+  class RealTimeClockInternal;
+
+  // Timer thread shared by many clocks, ticks them at absolute deadlines in
+  // the order they are due. On Linux it sleeps on a timerfd armed with the
+  // earliest deadline, elsewhere with millisecond precision on an event.
+
+  class RealTimeClockThread {
+    public:
+      explicit RealTimeClockThread(const Worker::WorkerOptions &options);
+      ~RealTimeClockThread();
+
+      void Schedule(const Let<RealTimeClockInternal> &clock, uint32_t interval_ms, uint32_t generation);
+      void Release();
+
+      inline size_t Clocks() const {
+        return _clocks.load();
+      }
+
+    protected:
+      class Entry {
+        public:
+          int64_t deadline;
+          int64_t interval;
+          uint32_t generation;
+          WeakLet<RealTimeClockInternal> clock;
+
+          inline bool operator<(const Entry &entry) const {
+            return (deadline > entry.deadline);
+          }
+      };
+
+      void Process();
+      void Sleep(int64_t deadline);
+      void WakeUp();
+
+      static bool Run(void* obj);
+
+      rtc::CriticalSection _lock;
+      std::priority_queue<Entry> _entries GUARDED_BY(_lock);
+      std::atomic<size_t> _clocks;
+#ifdef CRTC_OS_LINUX
+      int _timer;
+      int _wakeup;
+#else
+      rtc::Event _wakeup;
+#endif
+      Worker::WorkerOptions _options;
+      bool _configured;
+      std::atomic<bool> _stopping;
+      rtc::PlatformThread _thread;
   };
 
   class RealTimeClockInternal : public RealTimeClock {
       friend class RealTimeClock;
-      friend class Let<RealTimeClock>;
+      friend class RealTimeClockThread;
+      friend class Let<RealTimeClockInternal>;
 
     public:
+      static const size_t kMaxThreads = 4;
+
       void Start(uint32_t interval_ms = 0) override;
       void Stop() override;
 
+      ClockStats Stats() const override;
+
     protected:
-      explicit RealTimeClockInternal(const Callback &runnable);
+      explicit RealTimeClockInternal(const Callback &runnable, Policy policy);
       ~RealTimeClockInternal() override;
 
-      std::unique_ptr<webrtc::EventTimerWrapper> _tick;
-      rtc::PlatformThread _thread;
-      rtc::PlatformThreadId _signal;
+      int64_t Tick(uint32_t generation, int64_t deadline, int64_t interval);
+
+      static RealTimeClockThread *Pick();
+
+      mutable rtc::CriticalSection _lock;
+      bool _running GUARDED_BY(_lock);
+      std::atomic<uint32_t> _generation;
+      RealTimeClockThread *_thread GUARDED_BY(_lock);
+      ClockStats _stats GUARDED_BY(_lock);
 
       Callback _runnable;
-      
-      static bool Run(void* obj);
+      Policy _policy;
   };
 };
 